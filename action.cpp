@@ -6,112 +6,68 @@
 
 #include "parameters.h"
 #include "scalar.h"
+#include "geometry.h"
+#include "soa_field.h"
+#include "action.h"
 #include "types.h"
 
 
 
 //###########################################################################################//
 // (I.)                                                                                      //
+//    Function for the calculation of the action S. The field is converted into separate     //
+//  arrays for the real and imaginary parts (see "soa_field.cpp"), on which the sum over the //
+//  lattice is vectorised. These arrays are allocated at the first call and reused by all    //
+//          later ones (the action is only evaluated outside of parallel regions):           //
 //                                                                                           //
 //###########################################################################################//
 
+static soa_field eval_action_aux = {NULL, NULL};
+
 double eval_action_nogauge(scalar_field phi) {   // scalar_field defined in "types.h" as
                                                  // complex;
                                                  // phi defined in "calculate_toytest.cpp".
   double action = 0.;
-  int x,y,z,t,gamma;
-  int ipt;
-  float add=0;
-  
-  for(t=0;t<T;t++) {
-    for(x=0;x<X;x++) {
-      for(y=0;y<Y;y++) {
-	for(z=0;z<Z;z++) {
-
-	  // LAMBDA*(phi^2 - 1)^2 + phi^2
-	  add=0;
-          add = prod_complex( conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,y,z)]).re;
-	  action += LAMBDA*( add -1 )*( add -1 ) + add; 
-
-	  // -KAPPA  phi_x^* U_x,mu phi_x+mu +cc)
-	  add=0;
-	  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point((t+1)%T,x,y,z)]).re;
-	  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,(x+1)%X,y,z)]).re;
-	  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,(y+1)%Y,z)]).re;
-	  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,y,(z+1)%Z)]).re;
-	  
-	  action += -KAPPA*2*add;
-	  
-	}
-      }
-    }
+
+  if(eval_action_aux.re == NULL) {
+    soa_alloc(&eval_action_aux);
   }
+
+  // LAMBDA*(phi^2 - 1)^2 + phi^2 -KAPPA  phi_x^* U_x,mu phi_x+mu +cc), see "soa_field.cpp":
+  soa_from_field(&eval_action_aux, phi);
+  action = soa_eval_action(&eval_action_aux);
+
   return action;
 };
 
 
 
-//###########################################################################################//
-// (II.)                                                                                     //
-//     Function for the  calculation of the change in action \Delta S, which is needed in    //
-//                                       "metropolis.cpp":                                   //
-//                                                                                           //
-//###########################################################################################//
+// The action together with the other sums of chain_observables (see "action.h"), all
+// computed from scratch:
+void eval_observables(scalar_field phi, chain_observables *p_obs) {
 
-double delta_action_nogauge(scalar_field phi, scalar_field phi_new, int x, int y, int z, int t) {
-  
-  double action = 0.;
-  double action_new = 0.;
-  int ipt;
-  float add=0;
-
-  //=========================================================================================//
-  //                                                                                         //
-  // Calculation of the Euclidean action S_E:                                                //
-  //                                                                                         //
-  //=========================================================================================//
-  
-  // LAMBDA*(phi^2 - 1)^2 + phi^2
-  add=0;
-  add = prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,y,z)]).re;
-  action += LAMBDA*( add -1 )*( add -1 ) + add; 
-  
-  // -KAPPA  phi_x phi_x 
-  add=0;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point((t+1)%T,x,y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,(x+1)%X,y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,(y+1)%Y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,y,(z+1)%Z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point((T+t-1)%T,x,y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,(X+x-1)%X,y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,(Y+y-1)%Y,z)]).re;
-  add += prod_complex(conjugate(phi[lattice_point(t,x,y,z)]),phi[lattice_point(t,x,y,(Z+z-1)%Z)]).re;
-  
-  action += -1*KAPPA*add*2;
-
-  //=========================================================================================//
-  //                                                                                         //
-  // Calculation of the new action S_E,new:                                                  //
-  //                                                                                         //
-  //=========================================================================================//
-  
-  // LAMBDA*(phi^2 - 1)^2 + phi^2    
-  add=0;
-  add = prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,x,y,z)]).re;
-  action_new += LAMBDA*( add -1 )*( add -1 ) + add; 
-  
-  // -KAPPA  phi_x phi_x 
-  add=0;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point((t+1)%T,x,y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,(x+1)%X,y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,x,(y+1)%Y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,x,y,(z+1)%Z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point((T+t-1)%T,x,y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,(X+x-1)%X,y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,x,(Y+y-1)%Y,z)]).re;
-  add += prod_complex(conjugate(phi_new[lattice_point(t,x,y,z)]),phi_new[lattice_point(t,x,y,(Z+z-1)%Z)]).re;
-  
-  action_new += -1*KAPPA*add*2;
-
-  return (action_new - action);
-};
+  double potential = 0., phi2 = 0., hopping = 0., mag_re = 0., mag_im = 0.;
+  double rho;
+  int ipt, mu;
+
+#pragma omp parallel for private(rho, mu) reduction(+:potential, phi2, hopping, mag_re, mag_im)
+  for(ipt=0;ipt<volume;ipt++) {
+
+    rho = phi[ipt].re*phi[ipt].re + phi[ipt].im*phi[ipt].im;
+    potential += LAMBDA*(rho - 1)*(rho - 1) + rho;
+    phi2      += rho;
+    mag_re    += phi[ipt].re;
+    mag_im    += phi[ipt].im;
+
+    // Forward neighbours only, so that every link is counted once (see "geometry.h"):
+    for(mu=0;mu<4;mu++) {
+      hopping += prod_complex(conjugate(phi[ipt]),phi[neighbour(ipt,mu)]).re;
+    }
+  }
+
+  p_obs->action           = potential - 2*KAPPA*hopping;
+  p_obs->phi2             = phi2;
+  p_obs->hopping          = hopping;
+  p_obs->magnetisation.re = mag_re;
+  p_obs->magnetisation.im = mag_im;
+}
@@ -1,5 +1,60 @@
+#pragma once
+
 #include "types.h"
+#include "geometry.h"
+
+// Sums over the lattice that are measured with the action (see eval_observables()). The
+// Metropolis algorithm keeps them up to date with every accepted update (see "metropolis.cpp"):
+struct chain_observables {
+  double action;           // S
+  double phi2;             // sum_x |phi_x|^2
+  double hopping;          // sum_x sum_{mu forward} Re(phi_x^* phi_{x+mu})
+  complex magnetisation;   // sum_x phi_x
+};
 
+// The action S of phi. It converts phi into a static scratch field (see "action.cpp"), so it is
+// not reentrant and must not be called from several threads at once:
 double eval_action_nogauge(scalar_field phi);
-double delta_action_nogauge(scalar_field phi, scalar_field phi_new,int x, int y, int z, int t);
+void eval_observables(scalar_field phi, chain_observables *p_obs);
   
+
+// Sum b of the n_neighbours nearest neighbours of the lattice point ipt (see "geometry.h"):
+static inline complex neighbour_sum(scalar_field phi, int ipt) {
+
+  complex b(0., 0.);
+  int mu;
+
+  for(mu=0;mu<n_neighbours;mu++) {
+    b.re += phi[neighbour(ipt,mu)].re;
+    b.im += phi[neighbour(ipt,mu)].im;
+  }
+  return b;
+}
+
+// lambda*(|phi|^2 - 1)^2 + |phi|^2 of a single field point for the coupling lambda:
+static inline double local_potential_at(complex phi_x, double lambda) {
+
+  double rho = phi_x.re*phi_x.re + phi_x.im*phi_x.im;
+  return lambda*(rho - 1)*(rho - 1) + rho;
+}
+
+// LAMBDA*(|phi|^2 - 1)^2 + |phi|^2 of a single field point:
+static inline double local_potential(complex phi_x) {
+  return local_potential_at(phi_x, LAMBDA);
+}
+
+// Change of the action with the couplings kappa and lambda if phi_old is replaced by phi_new at
+// a lattice point with neighbour sum b (see local_delta_action()):
+static inline double local_delta_action_at(complex phi_old, complex phi_new, complex b,
+					   double kappa, double lambda) {
+
+  return local_potential_at(phi_new, lambda) - local_potential_at(phi_old, lambda)
+    - 2*kappa*((phi_new.re - phi_old.re)*b.re + (phi_new.im - phi_old.im)*b.im);
+}
+
+// Change of the action \Delta S if phi_old is replaced by phi_new at a lattice point with
+// neighbour sum b. Only these three values are needed, so the Metropolis hits at one point
+// neither read the neighbours again nor write the proposal into a field:
+static inline double local_delta_action(complex phi_old, complex phi_new, complex b) {
+  return local_delta_action_at(phi_old, phi_new, b, KAPPA, LAMBDA);
+}
@@ -0,0 +1,291 @@
+#include <omp.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "complex.h"
+#include "types.h"
+#include "analysis.h"
+#include "parameters.h"
+#include "scalar.h"
+#include "field_io.h"
+#include "ensemble.h"
+#include "correlators.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// The analysis of "calculate_corr.cpp" is a pipeline of three stages:                       //
+//   - n_readers reader threads load (parse, map or convert) the configurations into a       //
+//     bounded queue of queue_depth entries,                                                 //
+//   - n_workers worker threads take whole configurations from the queue and calculate all   //
+//     n particle correlators of them (see "correlators.cpp"),                               //
+//   - the calling thread writes the results in the order of the configurations, so the      //
+//     output does not depend on the number of threads.                                      //
+// At most queue_depth + n_readers + n_workers configurations are held in memory.            //
+//                                                                                           //
+//*******************************************************************************************//
+
+struct loaded_conf {
+  int seq;                // position of the configuration in the output
+  scalar_field phi;       // points to buffer or into a mapped file
+  scalar_field buffer;
+  mapped_field map;
+  int mapped;             // map has to be released by unmap_field()
+};
+
+struct pipeline {
+  std::mutex lock;
+  std::condition_variable not_full, not_empty, result_ready;
+
+  int n_tasks;
+  int *tasks;             // configuration numbers i of the analysed configurations
+  int next_task;          // next task handed out to a reader
+
+  loaded_conf *queue;     // ring buffer of queue_depth entries
+  int head, count, n_popped;
+
+  complex **results;      // results[seq][(n-1)*T + dt], NULL until calculated
+
+  ensemble const *p_ens;
+};
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Load the configuration n_conf = (i+1)*n_term_save (the record i of the ensemble file    //
+//   if save_tau_factor > 0). Binary configurations (field_format 1 or 2) are mapped into    //
+//   memory instead of being parsed (see "field_io.cpp"), records of an ensemble file are    //
+//                                 found by the index:                                       //
+//                                                                                           //
+//###########################################################################################//
+
+static void load_configuration(pipeline const *p_pipe, int i, loaded_conf *p_conf) {
+
+  char filename_sc[256];
+  long long n_conf = (long long) (i+1)*n_term_save;
+  int k_conf;
+
+  p_conf->buffer = (scalar_field) malloc(volume * sizeof(complex));
+  p_conf->mapped = 0;
+
+  if(p_pipe->p_ens != NULL) {
+    // With an adapted save interval (save_tau_factor > 0) the trajectory numbers are not on
+    // the grid of n_term_save, the records are taken in the order of the file:
+    k_conf = (save_tau_factor > 0 ? (i < p_pipe->p_ens->n_conf ? i : -1)
+	      : ensemble_find(p_pipe->p_ens, n_conf));
+    if(k_conf < 0) {
+      printf("n_conf=%lld is not in %s\n", n_conf, p_pipe->p_ens->filename);
+      exit(1);
+    }
+    ensemble_get(p_pipe->p_ens,k_conf,&p_conf->map,1);
+    p_conf->phi = mapped_field_phi(&p_conf->map,p_conf->buffer);
+  }
+  else if(field_format == 0) {
+    sprintf(filename_sc,"%sscalar_%d_%d_%d_%d_%lld.txt", path_read, X,Y,Z,T, n_conf);
+    fread_field(filename_sc,&p_conf->buffer);
+    p_conf->phi = p_conf->buffer;
+  }
+  else {
+    sprintf(filename_sc,"%sscalar_%d_%d_%d_%d_%lld.bin", path_read, X,Y,Z,T, n_conf);
+    map_field(filename_sc,&p_conf->map,1);
+    p_conf->phi = mapped_field_phi(&p_conf->map,p_conf->buffer);
+    p_conf->mapped = 1;
+  }
+}
+
+static void release_configuration(loaded_conf *p_conf) {
+
+  // Records of an ensemble file belong to its mapping (see "ensemble.h"):
+  if(p_conf->mapped) {
+    unmap_field(&p_conf->map);
+  }
+  free(p_conf->buffer);
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//                       The reader, worker and writer stages:                               //
+//                                                                                           //
+//###########################################################################################//
+
+static void reader(pipeline *p_pipe) {
+
+  loaded_conf conf;
+
+  while(1) {
+
+    {
+      std::unique_lock<std::mutex> guard(p_pipe->lock);
+      if(p_pipe->next_task == p_pipe->n_tasks) break;
+      conf.seq = p_pipe->next_task++;
+    }
+
+    load_configuration(p_pipe, p_pipe->tasks[conf.seq], &conf);
+
+    std::unique_lock<std::mutex> guard(p_pipe->lock);
+    p_pipe->not_full.wait(guard, [p_pipe] { return p_pipe->count < queue_depth; });
+    p_pipe->queue[(p_pipe->head + p_pipe->count) % queue_depth] = conf;
+    p_pipe->count++;
+    p_pipe->not_empty.notify_one();
+  }
+}
+
+static void worker(pipeline *p_pipe) {
+
+  int momentum[3] = {0, 0, 0};
+  momentum_projector proj;
+  projected_field phi_t = {0, NULL};
+  loaded_conf conf;
+  complex *corr_all;
+
+  // The workers already run in parallel, the kernels of "soa_field.cpp" must not start
+  // further threads:
+  omp_set_num_threads(1);
+
+  // The plane waves of the analysed momenta (only p = 0 so far) are computed only once:
+  init_projector(&proj, 1, momentum);
+
+  while(1) {
+
+    {
+      std::unique_lock<std::mutex> guard(p_pipe->lock);
+      p_pipe->not_empty.wait(guard, [p_pipe] {
+	  return p_pipe->count > 0 || p_pipe->n_popped == p_pipe->n_tasks; });
+      if(p_pipe->count == 0) break;
+      conf = p_pipe->queue[p_pipe->head];
+      p_pipe->head = (p_pipe->head + 1) % queue_depth;
+      p_pipe->count--;
+      p_pipe->n_popped++;
+      p_pipe->not_full.notify_one();
+      if(p_pipe->n_popped == p_pipe->n_tasks) p_pipe->not_empty.notify_all();
+    }
+
+    // Every configuration is projected onto the momenta of proj only once. The n particle
+    // correlation functions of all n and dt are then built from the projected field:
+    corr_all = (complex *) malloc(n_fields*T * sizeof(complex));
+    project_field(&proj,conf.phi,&phi_t);
+    correlator_ladder(&phi_t,0,n_fields,corr_all);
+    release_configuration(&conf);
+
+    std::unique_lock<std::mutex> guard(p_pipe->lock);
+    p_pipe->results[conf.seq] = corr_all;
+    p_pipe->result_ready.notify_all();
+  }
+
+  free_projected_field(&phi_t);
+  free_projector(&proj);
+}
+
+static void write_correlators(FILE **fconf_n, complex const *corr_all) {
+
+  int n,j;
+  complex *corr_n = (complex *) malloc((T/2+1) * sizeof(complex));
+
+  for(n=0;n<n_fields;n++) {
+
+    for(j=0;j<T/2+1;j++) {
+
+      // The n particle correlation function:
+      if(correlator == 0) {
+	corr_n[j] = corr_all[n*T + j];
+      }
+
+      // The derivative of the n particle correlation function:
+      if(correlator == 1) {
+	corr_n[j] = sub_complex(corr_all[n*T + j], corr_all[n*T + (j+1)%T]);
+      }
+    }
+
+    for(j=0;j<T/2+1;j++) {
+      fprintf(fconf_n[n],"%d %e %e \n", j, corr_n[j].re, corr_n[j].im);
+    }
+
+    for(j=T/2+1;j<T;j++) {
+      fprintf(fconf_n[n],"%d %e %e \n", j, corr_n[T-j].re, corr_n[T-j].im);
+    }
+  }
+
+  free(corr_n);
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Start the readers and workers and write the results of every (n_restrict)th             //
+//             configuration i < n_analyse in the order of the configurations:               //
+//                                                                                           //
+//###########################################################################################//
+
+int analyse_configurations(ensemble const *p_ens, FILE **fconf_n) {
+
+  pipeline pipe;
+  std::vector<std::thread> threads;
+  int i,seq;
+  int n_read = n_readers;
+  int n_work = (n_workers > 0 ? n_workers : omp_get_max_threads());
+
+  if(n_read < 1 || queue_depth < 1) {
+    printf("n_readers and queue_depth must be at least 1\n");
+    exit(1);
+  }
+
+  pipe.p_ens = p_ens;
+  pipe.tasks = (int *) malloc(n_analyse * sizeof(int));
+  pipe.n_tasks = 0;
+  for(i=0;i<n_analyse;i++) {
+    if(i%n_restrict==0) {
+      pipe.tasks[pipe.n_tasks++] = i;
+    }
+  }
+  pipe.next_task = 0;
+  pipe.queue = (loaded_conf *) malloc(queue_depth * sizeof(loaded_conf));
+  pipe.head = 0;
+  pipe.count = 0;
+  pipe.n_popped = 0;
+  pipe.results = (complex **) calloc(pipe.n_tasks, sizeof(complex *));
+
+  printf("Analysis with %d reader(s), %d worker(s) and a queue of %d configurations\n",
+	 n_read, n_work, queue_depth);
+
+  for(i=0;i<n_read;i++) {
+    threads.push_back(std::thread(reader, &pipe));
+  }
+  for(i=0;i<n_work;i++) {
+    threads.push_back(std::thread(worker, &pipe));
+  }
+
+  for(seq=0;seq<pipe.n_tasks;seq++) {
+
+    {
+      std::unique_lock<std::mutex> guard(pipe.lock);
+      pipe.result_ready.wait(guard, [&pipe, seq] { return pipe.results[seq] != NULL; });
+    }
+
+    write_correlators(fconf_n, pipe.results[seq]);
+    free(pipe.results[seq]);
+
+    if((pipe.tasks[seq]+1)%100==0) {
+      printf("Analysed conf number %d \n",pipe.tasks[seq]+1);
+    }
+  }
+
+  for(i=0;i<(int) threads.size();i++) {
+    threads[i].join();
+  }
+
+  free(pipe.tasks);
+  free(pipe.queue);
+  free(pipe.results);
+  return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "ensemble.h"
+
+// Pipelined analysis of the configurations n_conf = (i+1)*n_term_save (see "analysis.cpp").
+// The correlators of n = 1,...,n_fields are written to fconf_n[n-1]. p_ens is NULL unless
+// the configurations are read from an ensemble file.
+int analyse_configurations(ensemble const *p_ens, FILE **fconf_n);
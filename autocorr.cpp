@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "parameters.h"
+#include "action.h"
+#include "autocorr.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Gamma method with the automatic windowing of U. Wolff (hep-lat/0306017), computed online. //
+// For the values a_0,...,a_{n-1} of an observable the autocorrelation function is           //
+//   Gamma(t) = 1/(n-t) sum_{i<n-t} (a_i - mean)(a_{i+t} - mean)                             //
+//            = (C_t - mean*(P_t + Q_t) + (n-t)*mean^2)/(n-t)                                //
+// with C_t = sum_i a_i a_{i+t}, P_t = sum_{i<n-t} a_i and Q_t = sum_{i>=t} a_i. P_t and Q_t //
+// follow from the sum of all values, the last and the first t values, so C_t for t <= w_max //
+// and 2*w_max values are all that is stored. tau_int(W) = 1/2 + sum_{t=1}^W Gamma(t)/       //
+// Gamma(0) is summed up to the first W with g(W) = exp(-W/tau(W)) - tau(W)/sqrt(W*n) < 0,   //
+// tau(W) = S/ln((2 tau_int(W) + 1)/(2 tau_int(W) - 1)) and S = autocorr_S, its error is     //
+// tau_int*sqrt(2*(2W+1)/n).                                                                 //
+//                                                                                           //
+//*******************************************************************************************//
+
+#define autocorr_S 1.5
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//                          Add a measurement to the time series:                            //
+//                                                                                           //
+//###########################################################################################//
+
+int init_autocorr_series(autocorr_series *s, int w_max) {
+
+  memset(s, 0, sizeof(autocorr_series));
+  s->w_max   = w_max;
+  s->first   = (double *) calloc(w_max, sizeof(double));
+  s->last    = (double *) calloc(w_max, sizeof(double));
+  s->lag_sum = (double *) calloc(w_max+1, sizeof(double));
+  return 0;
+}
+
+void free_autocorr_series(autocorr_series *s) {
+
+  free(s->first);
+  free(s->last);
+  free(s->lag_sum);
+}
+
+void autocorr_add(autocorr_series *s, double a) {
+
+  long const n = s->n;
+  int t, t_max;
+  double b;
+
+  if(n == 0) {
+    s->shift = a;
+  }
+  b = a - s->shift;
+
+  if(n < s->w_max) {
+    s->first[n] = b;
+  }
+
+  // a_n a_{n-t}, the value a_{n-w_max} is overwritten only afterwards:
+  s->lag_sum[0] += b*b;
+  t_max = (n < s->w_max ? (int) n : s->w_max);
+  for(t=1;t<=t_max;t++) {
+    s->lag_sum[t] += b*s->last[(n-t)%s->w_max];
+  }
+
+  s->last[n%s->w_max] = b;
+  s->sum += b;
+  s->n++;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//                   Integrated autocorrelation time by the windowing:                       //
+//                                                                                           //
+//###########################################################################################//
+
+void autocorr_estimate_tau(autocorr_series const *s, autocorr_estimate *p_est) {
+
+  long const n = s->n;
+  int const w_max = (n-1 < s->w_max ? (int) (n-1) : s->w_max);
+  double const mean = (n > 0 ? s->sum/n : 0.);
+  double head = 0., tail = 0., gamma0 = 0., gamma, tau_int = 0.5, tau, g;
+  int t;
+
+  memset(p_est, 0, sizeof(autocorr_estimate));
+  p_est->mean    = mean + s->shift;
+  p_est->tau_int = 0.5;
+
+  if(n < 2) {
+    return;
+  }
+  gamma0 = (s->lag_sum[0] - 2*mean*s->sum + n*mean*mean)/n;
+  if(gamma0 <= 0) {
+    p_est->converged = 1;
+    return;
+  }
+
+  for(t=1;t<=w_max;t++) {
+
+    // Sums of the first and of the last t values:
+    head += s->first[t-1];
+    tail += s->last[(n-t)%s->w_max];
+
+    gamma = (s->lag_sum[t] - mean*((s->sum - tail) + (s->sum - head)) + (n-t)*mean*mean)/(n-t);
+    tau_int += gamma/gamma0;
+
+    tau = (tau_int <= 0.5 ? 1e-9 : autocorr_S/log((2*tau_int + 1)/(2*tau_int - 1)));
+    g = exp(-t/tau) - tau/sqrt((double) t*n);
+
+    if(g < 0) {
+      p_est->converged = 1;
+      break;
+    }
+  }
+  if(t > w_max) {
+    t = w_max;
+  }
+
+  p_est->window    = t;
+  p_est->tau_int   = (tau_int > 0.5 ? tau_int : 0.5);
+  p_est->d_tau_int = p_est->tau_int*sqrt(2.*(2*t + 1)/n);
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   The observables of autocorr_observable (see "autocorr.h"). The correlator of n = 1 is   //
+//   1/(T*X*Y*Z) sum_t Re(Phi(t)^* Phi(t + d)) with the time slice sums Phi(t) of phi and    //
+//                                d = autocorr_distance():                                   //
+//                                                                                           //
+//###########################################################################################//
+
+int autocorr_distance(void) {
+  return (T >= 4 ? T/4 : T/2);
+}
+
+void autocorr_measure(scalar_field phi, double *values) {
+
+  chain_observables obs;
+  double *slice_re = (double *) calloc(T, sizeof(double));
+  double *slice_im = (double *) calloc(T, sizeof(double));
+  double corr = 0.;
+  int const d = autocorr_distance();
+  int ipt, t;
+
+  eval_observables(phi, &obs);
+
+  // t is the fastest index of the lattice point (see lattice_point() in "scalar.cpp"):
+  for(ipt=0;ipt<volume;ipt++) {
+    slice_re[ipt%T] += phi[ipt].re;
+    slice_im[ipt%T] += phi[ipt].im;
+  }
+  for(t=0;t<T;t++) {
+    corr += slice_re[t]*slice_re[(t+d)%T] + slice_im[t]*slice_im[(t+d)%T];
+  }
+
+  values[autocorr_action] = obs.action;
+  values[autocorr_phi2]   = obs.phi2/volume;
+  values[autocorr_corr]   = corr/volume;
+
+  free(slice_re);
+  free(slice_im);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.h"
+
+// Time series of one observable for the online Gamma method (see "autocorr.cpp"). Only the
+// sums needed for the autocorrelation function up to the lag w_max are kept, the memory does
+// not grow with the number of measurements:
+struct autocorr_series {
+  int w_max;
+  long n;              // number of measurements
+  double shift;        // first measurement, subtracted from all values against cancellations
+  double sum;          // sum_i a_i
+  double *first;       // a_0,...,a_{w_max-1}
+  double *last;        // a_{n-w_max},...,a_{n-1} (ring buffer, a_i at last[i%w_max])
+  double *lag_sum;     // sum_i a_i a_{i+t}, t = 0,...,w_max
+};
+
+// Result of the automatic windowing of U. Wolff, Comput. Phys. Commun. 156 (2004) 143:
+struct autocorr_estimate {
+  double mean;
+  double tau_int;      // integrated autocorrelation time in measurements
+  double d_tau_int;    // its statistical error
+  int window;          // summation window W
+  int converged;       // 1 if the window was found below w_max
+};
+
+// Observables of the online analysis of "calculate_toytest.cpp":
+enum autocorr_observable {
+  autocorr_action = 0,   // S
+  autocorr_phi2   = 1,   // sum_x |phi_x|^2 / volume
+  autocorr_corr   = 2,   // zero momentum correlator of n = 1 at the distance autocorr_distance()
+  autocorr_n_obs  = 3
+};
+
+int init_autocorr_series(autocorr_series *s, int w_max);
+void free_autocorr_series(autocorr_series *s);
+void autocorr_add(autocorr_series *s, double a);
+void autocorr_estimate_tau(autocorr_series const *s, autocorr_estimate *p_est);
+
+int autocorr_distance(void);
+void autocorr_measure(scalar_field phi, double *values);
@@ -12,13 +12,14 @@
 #include "action.h"
 #include "parameters.h"
 #include "scalar.h"
+#include "geometry.h"
+#include "field_io.h"
+#include "ensemble.h"
 #include "metropolis.h"
-#include "correlators.h"
+#include "analysis.h"
 
 
 
-double KAPPA,LAMBDA;
-
 static FILE* save_fopen(const char filename[]) {
   
   FILE* f = fopen(filename, "w");
@@ -32,48 +33,30 @@ return f;
 
 
 
-//###########################################################################################//
-// (I.)                                                                                      //
-//              Function for the calculation of the parameters Lambda and Kappa              //
-//(needed for the calculation of the action S; here: metadata for the correlation functions)://
-//                                                                                           //
-//###########################################################################################//
-
-void calculate_parameters() {
-  
-  LAMBDA = (4*lambda_c - (8+m2_0)*(-8 -m2_0 + sqrt(8*lambda_c + (8+m2_0)*(8+m2_0))))/(8*lambda_c);
-  KAPPA = (-8 - m2_0 + sqrt(8*lambda_c + (8.0+m2_0)*(8.0+m2_0)))/(4*lambda_c);
-  
-  if(KAPPA<0 || KAPPA>1) {
-    
-    LAMBDA = (4*lambda_c + (8+m2_0)*(8 +m2_0 + sqrt(8*lambda_c + (8+m2_0)*(8+m2_0))))/(8*lambda_c);
-    KAPPA = (-8 - m2_0 - sqrt(8*lambda_c + (8.0+m2_0)*(8.0+m2_0)))/(4*lambda_c);    
-  }
-}
-
-
-
 //###########################################################################################//
 // (II.)                                                                                     //
 //                 ROUTINE FOR THE CALCULATION OF THE CORRELATION FUNCTIONS:                 //
 //                                                                                           //
 //###########################################################################################//
 
-int main() {
+int main(int argc, char *argv[]) {
   
   double time0=omp_get_wtime( );
   
   char corr_filename_n[40] = "";
-  char filename_sc[70] = "";
   
   //int n = n_fields; // This is only needed if one omits the for loop over n
   long n;
-  int i,j;
-  complex corr_n[T];
+  FILE **fconf_n;
   
-  scalar_field phi;
+  ensemble ens;
+  char ensemble_path[512];
   
   clock_t begin = clock();
+
+
+  // Read the lattice size and all other parameters (see "parameters.cpp"):
+  read_parameters(argc, argv);
   
   
   //=========================================================================================//
@@ -119,13 +102,20 @@ int main() {
   
   //=========================================================================================//
   // (II.C)                                                                                  //
-  // Initialize field (see "scalar.cpp") and calculate KAPPA, LAMBDA:                        //
+  // Build the neighbour table (see "geometry.cpp") and calculate KAPPA, LAMBDA:             //
   //                                                                                         //
   //=========================================================================================//
   
-  initialize_field(&phi);
+  init_geometry();
   calculate_parameters();
 
+  // The ensemble file (if ensemble_file is set) is opened and mapped only once:
+  if(ensemble_file[0] != '\0') {
+    snprintf(ensemble_path, sizeof(ensemble_path), "%s/%s", path_read, ensemble_file);
+    ensemble_open_read(ensemble_path, &ens);
+    printf("%s contains %d configurations\n", ensemble_path, ens.n_conf);
+  }
+
   
   //=========================================================================================//
   // (II.D)                                                                                  //
@@ -136,11 +126,11 @@ int main() {
   //                                                                                         //
   //=========================================================================================//
 
-  char path_corr_aux[80];
-  sprintf(path_corr_aux, path_corr);
+  char path_corr_aux[200];
+  sprintf(path_corr_aux, "%s", path_corr);
   
   char meta_file[30]  = "metadata_conf.tsv";
-  char path_meta[120];
+  char path_meta[240];
   strcpy(path_meta, path_corr_aux);
   strcat(path_meta, meta_file);
 
@@ -152,26 +142,24 @@ int main() {
   
   //=========================================================================================//
   // (II.E)                                                                                  //
-  // Here, one creates (fopen(...,"w")) and opens n_fields-times a correlator file for the   //
-  // n particle correlation function (1<=n<=n_fields) as well as the metadata file for       //
-  // writing in the folder "analysis" located at path_corr (see "parameters.h").             //
-  // The file ending ".tsv" stands for "tab-separated values":                               //
+  // Here, one creates (fopen(...,"w")) and opens a correlator file for each n particle      //
+  // correlation function (1<=n<=n_fields) for writing in the folder "analysis" located at   //
+  // path_corr (see "parameters.h"). All n_fields files stay open during the analysis, such  //
+  // that every configuration is read in only once. The file ending ".tsv" stands for        //
+  // "tab-separated values":                                                                 //
   //                                                                                         //
   //=========================================================================================//
 
+  fconf_n = (FILE **) malloc(n_fields * sizeof(FILE *));
+
   for(n=0;n<n_fields;n++) {
     
-    char path_corr_aux[80];
-    
-    sprintf(path_corr_aux, path_corr);
-    
-    char path_corr_n[120];
-    sprintf(corr_filename_n, "correlators_%d_phi_phi4p.tsv", (n+1));
+    char path_corr_n[240];
+    sprintf(corr_filename_n, "correlators_%ld_phi_phi4p.tsv", (n+1));
     strcpy(path_corr_n, path_corr_aux);
     strcat(path_corr_n, corr_filename_n);
     
-    
-    FILE *fconf_n = save_fopen(path_corr_n);
+    fconf_n[n] = save_fopen(path_corr_n);
     
     
     //=======================================================================================//
@@ -181,73 +169,41 @@ int main() {
     //                                                                                       //
     //=======================================================================================//
     
-    fprintf(fconf_n,"# Number of particles n_fields=%d \n", (n+1));
-    fprintf(fconf_n,"# LAMBDA=%f KAPPA=%f %f \n", LAMBDA,KAPPA);
-    fprintf(fconf_n,"# X=%d Y=%d Z=%d T=%d n_analyse=%d \n", X,Y,Z,T,n_analyse);
-    fprintf(fconf_n,"Point Re Im \n"); 
-    
-    
-    //=======================================================================================//
-    // (II.G)                                                                                //
-    // n_analyse-times txt-files containing the start configurations for the fields phi      //
-    // called "scalar_X_Y_Z_T_(i+1)*n_term_save" are read in, which are located at           //
-    // "path_read" (the number n_analyse and the path, where the start configurations are    //
-    // stored ("path_read") can be chosen in "parameters.h").                                // 
-    // By means of those fields phi, the correlation functions are build:                    //
-    //                                                                                       //
-    //=======================================================================================//
-    
-    for(i=0;i<n_analyse;i++) {
-      if(i%n_restrict==0) {
-	
-	sprintf(filename_sc,"%sscalar_%d_%d_%d_%d_%li.txt", path_read, X,Y,Z,T, (long long) (i+1)*n_term_save);
-	fread_field(filename_sc,&phi);      
-	
-#pragma omp parallel for private(j)
-	
-	// Since the field configuration arrays phi are provided by "fread_field", the n particle
-	// correlation functions "correlator_n()" that are defined in "correlators.cpp" can be
-	// calculated:
-	
-	for(j=0;j<T/2+1;j++) {
-
-	  // Calculate the n particle correlation function:
-	  if(correlator == 0) {
-	    corr_n[j] = correlator_n(phi,(n+1),j,0,0,0);
-	  }
-
-	  // Calculate the derivative of the n particle correlation function:
-	  if(correlator == 1) {
-	    corr_n[j] = sub_complex(correlator_n(phi,(n+1),j,0,0,0), correlator_n(phi,(n+1),(j+1),0,0,0));
-	  }
-	}
-	
-	for(j=0;j<T/2+1;j++) {
-	  fprintf(fconf_n,"%d %e %e \n", j, corr_n[j].re, corr_n[j].im);
-	}
-	
-	for(j=T/2+1;j<T;j++) {
-	  fprintf(fconf_n,"%d %e %e \n", j, corr_n[T-j].re, corr_n[T-j].im);
-	}
-	
-	if((i+1)%100==0) {
-	  printf("Analysed conf number %d \n",i+1);    
-	}
-      }
-      else{}
-    }
-    
-    
-    //=======================================================================================//
-    // (II.H)                                                                                //
-    // Close the files opened in (II.E):                                                     //
-    //                                                                                       //
-    //=======================================================================================//
-    
-    fclose(fconf_n);
-
-    
-  } // end of the for loop over n
+    fprintf(fconf_n[n],"# Number of particles n_fields=%ld \n", (n+1));
+    fprintf(fconf_n[n],"# LAMBDA=%f KAPPA=%f %f \n", LAMBDA,KAPPA);
+    fprintf(fconf_n[n],"# X=%d Y=%d Z=%d T=%d n_analyse=%d \n", X,Y,Z,T,n_analyse);
+    fprintf(fconf_n[n],"Point Re Im \n"); 
+  }
+  
+  
+  //=========================================================================================//
+  // (II.G)                                                                                  //
+  // n_analyse-times the configurations for the fields phi called                            //
+  // "scalar_X_Y_Z_T_(i+1)*n_term_save" are read in, which are located at "path_read" (the   //
+  // number n_analyse and the path, where the start configurations are stored ("path_read")  //
+  // can be chosen in "parameters.h").                                                       //
+  // By means of those fields phi, the correlation functions of all n are build. Reading and //
+  // analysing the configurations runs in parallel (see "analysis.cpp"):                     //
+  //                                                                                         //
+  //=========================================================================================//
+  
+  analyse_configurations((ensemble_file[0] != '\0' ? &ens : NULL), fconf_n);
+  
+  
+  //=========================================================================================//
+  // (II.H)                                                                                  //
+  // Close the files opened in (II.E):                                                       //
+  //                                                                                         //
+  //=========================================================================================//
+  
+  for(n=0;n<n_fields;n++) {
+    fclose(fconf_n[n]);
+  }
+  free(fconf_n);
+  
+  if(ensemble_file[0] != '\0') {
+    ensemble_close(&ens);
+  }
   
   double time1=omp_get_wtime( );
   printf("Duration %f seconds \n",time1-time0);
@@ -13,32 +13,18 @@
 #include "action.h"
 #include "parameters.h"
 #include "scalar.h"
+#include "geometry.h"
+#include "field_io.h"
+#include "ensemble.h"
 #include "metropolis.h"
 #include "correlators.h"
-
-
-
-//###########################################################################################//
-// (I.)                                                                                      //
-//             Function for the calculation of the parameters LAMBDA and KAPPA               //
-//                      (needed for the calculation of the action S):                        //
-//                                                                                           //
-//###########################################################################################//
-
-double KAPPA, LAMBDA;
-
-void calculate_parameters() {
-
-  LAMBDA = (4*lambda_c - (8+m2_0)*(-8 -m2_0 + sqrt(8*lambda_c + (8+m2_0)*(8+m2_0)))  )/(8*lambda_c);
-  KAPPA = (-8 - m2_0 + sqrt(8*lambda_c + (8.0+m2_0)*(8.0+m2_0)) )/(4*lambda_c);
-
-  if(KAPPA<0 || KAPPA>1) {
-    
-    LAMBDA = (4*lambda_c + (8+m2_0)*(8 +m2_0 + sqrt(8*lambda_c + (8+m2_0)*(8+m2_0)))  )/(8*lambda_c);
-    KAPPA = (-8 - m2_0 - sqrt(8*lambda_c + (8.0+m2_0)*(8.0+m2_0)) )/(4*lambda_c);
-    
-  }
-}
+#include "checkpoint.h"
+#include "hmc.h"
+#include "replica.h"
+#include "chains.h"
+#include "tune.h"
+#include "autocorr.h"
+#include "thermalise.h"
 
 
 
@@ -56,16 +42,24 @@ int main(int argc, char *argv[]) {
 
   double time0=omp_get_wtime( ), time0_b, time1_b;
 
-  scalar_field phi, phi2;                            // scalar_field defined in "types.h"
-  double action, action_next, acceptance, phase;
+  scalar_field phi;                                  // scalar_field defined in "types.h"
+  double action_next, acceptance = 0, phase;
   int i,j=0;
+  int n_interval, length;
   int n_tot;
-  complex corr[T], corr_im[T];
+  long long n_conf;
   complex caux, caux2;
-  complex corr_mean[T], vev_mean;
-  complex corr_mean_im[T];
+  complex vev_mean;
   char *endptr;    
   int nthreads, tid;
+  chain_state state = {0, 0, 0, 0, 0, NULL};
+  replica_set replicas;
+  chain_set chains;
+  hmc_state hmc_buffers;
+
+
+  // Read the lattice size and all other parameters (see "parameters.cpp"):
+  read_parameters(argc, argv);
 
   
   //=========================================================================================//
@@ -97,6 +91,16 @@ int main(int argc, char *argv[]) {
     mkdir(path_read, 0700);
   }
 
+  // All configurations are appended to one ensemble file if ensemble_file is set:
+  ensemble ens;
+  char ensemble_path[512];
+
+  if(ensemble_file[0] != '\0' && n_chain == 1) {
+    snprintf(ensemble_path, sizeof(ensemble_path), "%s/%s", path_read, ensemble_file);
+    ensemble_open_append(ensemble_path, &ens);
+    printf("Appending configurations to %s (%d already stored)\n", ensemble_path, ens.n_conf);
+  }
+
 
   //=========================================================================================//
   // (II.C)                                                                                  //
@@ -118,10 +122,13 @@ int main(int argc, char *argv[]) {
 
 	printf("T = %d\n", T);
   
-	if(nthreads > T/2 || T%nthreads!=0) {
-	  printf("Number of threads must be smaller then T/2 and T multiple of nthreads  \n");
+	// Both update modes work for any number of threads (the random-site updates by means of
+	// a block decomposition, see init_blocks() in "geometry.cpp"). The checkerboard sweeps
+	// (update_mode 1) need an even number of lattice points in every direction:
+	if((update_mode == 1 || n_replica > 1 || n_chain > 1) && (T%2!=0 || X%2!=0 || Y%2!=0 || Z%2!=0)) {
+	  printf("Checkerboard sweeps need even T, X, Y and Z \n");
 	  exit(0);
-	}	
+	}
      }
   }   // All threads join master thread and disband
 
@@ -130,13 +137,16 @@ int main(int argc, char *argv[]) {
 
   //=========================================================================================//
   // (II.D)                                                                                  //
-  // Create a file "action.out" ("w") and open it for writing:                               //
+  // Create a file "action.out" ("w") and open it for writing. A resumed chain (II.G) keeps  //
+  // the action history up to its checkpoint instead:                                        //
   //                                                                                         //
   //=========================================================================================//
   
-  FILE * faction;
-  faction = fopen("action.out", "w");
-  fprintf(faction, "step of %d\n", nprint_field);
+  FILE * faction = NULL, * fout;
+  if(resume == 0) {
+    faction = fopen("action.out", "w");
+    fprintf(faction, "step of %d\n", nprint_field);
+  }
 
   
   //=========================================================================================//
@@ -157,14 +167,14 @@ int main(int argc, char *argv[]) {
 
   //=========================================================================================//
   // (II.F)                                                                                  //
-  // Initialize the 2 fields needed in the course of the metropolis algorithm (The           //
+  // Initialize the field needed in the course of the metropolis algorithm (The              //
   // initialization process is controlled by the function initialize_field() defined in      //
-  // "scalar.cpp"):                                                                          //
+  // "scalar.cpp"). Before, the neighbour table is built (see "geometry.cpp"):               //
   //                                                                                         //
   //=========================================================================================//
   
+  init_geometry();
   initialize_field(&phi);
-  initialize_field(&phi2);
 
 
   //=========================================================================================//
@@ -175,7 +185,33 @@ int main(int argc, char *argv[]) {
   //                                                                                         //
   //=========================================================================================//
   
-  if(start_random == 0) {
+  // The time series of the online autocorrelation analysis (see (II.K)) are part of the
+  // state of the chain:
+  autocorr_series series[autocorr_n_obs];
+  int k;
+
+  if(n_autocorr > 0) {
+    for(k=0;k<autocorr_n_obs;k++) {
+      init_autocorr_series(&series[k], autocorr_w_max);
+    }
+    state.series = series;
+  }
+
+  // A resumed chain continues with the field and the state of the checkpoint (see
+  // "checkpoint.cpp"), the action history written after the checkpoint is discarded:
+  if(resume == 1) {
+    
+    read_checkpoint(checkpoint_file, phi, &state);
+    printf("Resuming from %s after %lld saved configurations (sweep %lld)\n",
+	   checkpoint_file, state.n_saved, sweep_count);
+    
+    if(truncate("action.out", state.action_bytes) != 0) {
+      printf("Failed to truncate action.out\n");
+      exit(1);
+    }
+    faction = fopen("action.out", "a");
+  }
+  else if(start_random == 0) {
     
     printf("start config for phi is %s \n", start_conf);
     fread_field(start_conf, &phi);
@@ -184,31 +220,120 @@ int main(int argc, char *argv[]) {
     printf("Lambda is %f and Kappa is %f \n", LAMBDA,KAPPA);    
 
   }
+  else if(start_random >= 2) {
+    
+    // Cold (ordered) or mean field start instead of the random phases (see "parameters.h"):
+    ordered_field(phi, (start_random == 2 ? 1. : mean_field_magnitude()));
+    printf("%s start with phi = %f \n", (start_random == 2 ? "Cold" : "Mean field"), phi[0].re);
+  }
 
 
   //=========================================================================================//
   // (II.H)                                                                                  //
   // If start_random is set to 1 (this is done in "parameters.h") a hot start is performed,  //
   // where a disordered, random configuration is utilized for the calculation of the field   //
-  // configurations (II.I):                                                                  //
+  // configurations (II.I). The ordered starts (start_random 2, 3) are thermalised alike,    //
+  // with n_therm_check > 0 until the action no longer drifts (see "thermalise.cpp"):        //
   //                                                                                         //
   //=========================================================================================//
   
   
-  if(start_random == 1) {
+  // With n_replica > 1 all replicas start from phi (see "replica.cpp"):
+  if(n_replica > 1) {
+    init_replicas(&replicas, phi);
+  }
+
+  // With n_chain > 1 all chains start from phi or their own random field (see "chains.cpp"):
+  if(n_chain > 1) {
+    init_chains(&chains, phi);
+  }
+
+  // The HMC buffers are allocated once for all trajectories (see "hmc.cpp"):
+  if(update_mode == 2) {
+    init_hmc(&hmc_buffers);
+  }
+
+  if(start_random != 0 && state.thermalised == 0) {
     
     printf("start action = %f\n", eval_action_nogauge(phi));
     printf("\n=====================================================\n");
     
-    acceptance = metropolis(&phi, n_term_field, faction);
+    // Local updates (update_mode 0, 1), HMC trajectories (update_mode 2, see "hmc.cpp") or
+    // sweeps of all replicas or chains (see "replica.cpp" and "chains.cpp"). With n_tune > 0
+    // they are made in intervals of n_tune steps, after each of which the proposal width is
+    // adapted to the acceptance (see "tune.cpp"). With n_therm_check > 0 the action is
+    // measured every n_therm_check steps and the thermalisation ends as soon as it no longer
+    // drifts (see "thermalise.cpp"):
+    n_interval = (n_tune > 0 ? n_tune : (n_therm_check > 0 ? n_therm_check : n_term_field));
+    if(n_interval > n_term_field) n_interval = n_term_field;
+    double *therm_action = (double *) malloc((n_therm_check > 0 ? n_term_field/n_therm_check + 1 : 1)
+					     * sizeof(double));
+    int n_therm_action = 0, stationary = 0;
+    double drift, drift_error;
+    acceptance = 0;
+    
+    for(j=0;j<n_term_field && !stationary;j+=n_interval) {
+      
+      length = (n_term_field - j < n_interval ? n_term_field - j : n_interval);
+      
+      // action.out gets one line for the whole thermalisation (see below for an early end):
+      fout = (j + length >= n_term_field ? faction : NULL);
+      
+      if(n_chain > 1)           acceptance = chains_metropolis(&chains, length, fout);
+      else if(n_replica > 1)    acceptance = replica_exchange(&replicas, length, fout);
+      else if(update_mode == 2) acceptance = hmc(&hmc_buffers, &phi, length, fout);
+      else                      acceptance = metropolis(&phi, length, fout);
+      
+      if(n_tune > 0) {
+	tune_proposal(acceptance);
+      }
+      if(n_therm_check > 0 && (j + length)%n_therm_check == 0) {
+	therm_action[n_therm_action++] = eval_action_nogauge(phi);
+	stationary = drift_test(therm_action, n_therm_action, therm_window, &drift, &drift_error);
+	printf("thermalisation: action = %f, drift = %f +- %f \n", therm_action[n_therm_action-1],
+	       drift, drift_error);
+      }
+    }
     printf("acceptance: %f \n", acceptance);
-  
+    if(n_therm_check > 0) {
+      printf("%s after %d steps \n", (stationary ? "Thermalised" : "No stationary action"),
+	     (j < n_term_field ? j : n_term_field));
+    }
+    // After an early end (single chain only) the line of the thermalisation is the running
+    // action of the last interval, i.e. the value metropolis() or hmc() would have written:
+    if(stationary && j < n_term_field) {
+      fprintf(faction, "%e\n", observables.action);
+    }
+    free(therm_action);
+    if(n_tune > 0) {
+      print_tuned_proposal();
+    }
+    
+    // The thermalised field is checkpointed, too:
+    state.thermalised = 1;
+    if(n_checkpoint > 0 && n_replica < 2 && n_chain < 2) {
+      fflush(faction);
+      state.action_bytes = ftell(faction);
+      write_checkpoint(checkpoint_file, phi, &state);
+    }
   }
+  state.thermalised = 1;
 
 
   clock_t endconf,startconf;
   double time_spentconf;
 
+  // Online autocorrelation analysis of the saved part of the chain (see (II.K)):
+  autocorr_estimate estimate;
+  const char *autocorr_names[autocorr_n_obs] = {"action", "|phi|^2", "C(d)"};
+  double values[autocorr_n_obs], tau_max;
+  int n_steps_save = (state.n_steps_save > 0 ? state.n_steps_save : n_term_save), converged;
+
+  if(n_autocorr > 0) {
+    printf("Measurements every %d steps, correlator C(d) at the distance d = %d \n", n_autocorr,
+	   autocorr_distance());
+  }
+
 
   //=========================================================================================//
   // (II.I)                                                                                  //
@@ -217,11 +342,31 @@ int main(int argc, char *argv[]) {
   //                                                                                         //
   //=========================================================================================//
   
-  for(i=0;i<n_save;i++) { // n_save is the number of configuration files saved at "path_read"
+  for(i=state.n_saved;i<n_save;i++) { // n_save is the number of configuration files saved at "path_read"
 
     time0_b = omp_get_wtime( );
     
-    acceptance = metropolis(&phi, n_term_save, faction);
+    // With n_autocorr > 0 the n_steps_save steps up to the next configuration are made in
+    // intervals of n_autocorr steps, each followed by a measurement (see "autocorr.cpp"):
+    n_interval = (n_autocorr > 0 ? n_autocorr : n_steps_save);
+    
+    for(j=0;j<n_steps_save;j+=n_interval) {
+      
+      // One line of action.out per saved configuration:
+      fout = (j + n_interval >= n_steps_save ? faction : NULL);
+      
+      if(n_chain > 1)           acceptance = chains_metropolis(&chains, n_interval, fout);
+      else if(n_replica > 1)    acceptance = replica_exchange(&replicas, n_interval, fout);
+      else if(update_mode == 2) acceptance = hmc(&hmc_buffers, &phi, n_interval, fout);
+      else                      acceptance = metropolis(&phi, n_interval, fout);
+      
+      if(n_autocorr > 0) {
+	autocorr_measure(phi, values);
+	for(k=0;k<autocorr_n_obs;k++) {
+	  autocorr_add(&series[k], values[k]);
+	}
+      }
+    }
     printf("out acceptance: %f \n", acceptance);
 
     
@@ -229,17 +374,99 @@ int main(int argc, char *argv[]) {
     // (II.J)                                                                                //
     // Print the ith field configuration (real and imaginary part of phi at all possible     //
     // field points (t,x,y,z) of the lattice) into a file opened by fprint_field()           //
-    // (see "scalar.cpp"):                                                                   //
+    // (see "scalar.cpp") or into a binary file (field_format 1 or 2, see "field_io.cpp").   //
+    // If ensemble_file is set, it is appended to the ensemble file (see "ensemble.cpp").    //
+    // With n_replica > 1 (n_chain > 1) the fields of all replicas (chains) are saved.       //
     //                                                                                       //
     //=======================================================================================//
     
-    fprint_field(phi, (long long) (i+1)*n_term_save + (long long) start_random_conf*(1-start_random));
+    // n_conf is the number of update steps since the thermalisation, (i+1)*n_term_save unless
+    // the steps between the configurations are adapted (see (II.K)):
+    state.n_steps += n_steps_save;
+    n_conf = state.n_steps + (long long) (start_random == 0 ? start_random_conf : 0);
+
+    // (A resumed chain may repeat configurations saved after its checkpoint.)
+    if(n_chain > 1) {
+      chains_save(&chains, n_conf);
+    }
+    else if(n_replica > 1) {
+      replica_save(&replicas, n_conf);
+    }
+    else if(ensemble_file[0] != '\0') {
+      if(ensemble_find(&ens, n_conf) < 0) {
+	ensemble_append(&ens, phi, n_conf, (field_format == 2 ? 4 : 8));
+      }
+    }
+    else if(field_format == 0) {
+      fprint_field(phi, n_conf);
+    }
+    else {
+      fprint_field_binary(phi, n_conf, (field_format == 2 ? 4 : 8));
+    }
     
     
+
+    //=======================================================================================//
+    // (II.K)                                                                                //
+    // Integrated autocorrelation times of the observables of "autocorr.h" from all          //
+    // measurements so far (in steps). With save_tau_factor > 0 the number of steps between  //
+    // two saved configurations is set to save_tau_factor times the largest of them, once    //
+    // there are autocorr_w_max measurements and the windows of all observables are found    //
+    // within autocorr_w_max:                                                                //
+    //                                                                                       //
+    //=======================================================================================//
+    
+    if(n_autocorr > 0) {
+      
+      tau_max    = 0.;
+      converged  = 1;
+      for(k=0;k<autocorr_n_obs;k++) {
+	autocorr_estimate_tau(&series[k], &estimate);
+	printf("tau_int(%s) = %f +- %f steps (mean %f, window %d%s) \n", autocorr_names[k],
+	       estimate.tau_int*n_autocorr, estimate.d_tau_int*n_autocorr, estimate.mean,
+	       estimate.window, (estimate.converged ? "" : ", not converged"));
+	if(estimate.tau_int*n_autocorr > tau_max) tau_max = estimate.tau_int*n_autocorr;
+	converged = converged && estimate.converged;
+      }
+      
+      if(save_tau_factor > 0 && converged && series[0].n >= autocorr_w_max) {
+	n_steps_save = n_autocorr * (int) ceil(save_tau_factor*tau_max/n_autocorr);
+	printf("steps between saved configurations: %d \n", n_steps_save);
+      }
+    }
+    
+
+    // Checkpoint after every n_checkpoint saved configurations (see "checkpoint.cpp"):
+    if(n_checkpoint > 0 && n_replica < 2 && n_chain < 2 && (i+1)%n_checkpoint == 0) {
+      fflush(faction);
+      state.n_saved      = i+1;
+      state.n_steps_save = n_steps_save;
+      state.action_bytes = ftell(faction);
+      write_checkpoint(checkpoint_file, phi, &state);
+    }
+    
     time1_b = omp_get_wtime( );
     printf("Duration %f seconds \n", time1_b-time0_b);
   }
   
+  if(ensemble_file[0] != '\0' && n_chain == 1) {
+    ensemble_close(&ens);
+  }
+  if(n_replica > 1) {
+    free_replicas(&replicas);
+  }
+  if(n_chain > 1) {
+    free_chains(&chains);
+  }
+  if(update_mode == 2) {
+    free_hmc(&hmc_buffers);
+  }
+  if(n_autocorr > 0) {
+    for(k=0;k<autocorr_n_obs;k++) {
+      free_autocorr_series(&series[k]);
+    }
+  }
+  
   double time1=omp_get_wtime( );
   printf("Duration %f seconds \n", time1-time0);
 }
@@ -0,0 +1,370 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "parameters.h"
+#include "geometry.h"
+#include "action.h"
+#include "scalar.h"
+#include "field_io.h"
+#include "ensemble.h"
+#include "metropolis.h"
+#include "rng.h"
+#include "chains.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Batched chains (n_chain > 1): a small lattice (6^3x8 has 1728 points) cannot keep many    //
+// cores busy with one chain, so n_chain independent chains with the seeds seed + c (c <     //
+// n_chain) are updated side by side. Their fields are stored as interleaved lanes, i.e.     //
+// the n_chain values of one lattice point are neighbours in memory. A checkerboard sweep    //
+// visits every lattice point once and updates all chains at that point in one loop over c,  //
+// which is vectorised; the lattice points of one parity are split across the threads as in  //
+// metropolis_sweep() (see "metropolis.cpp").                                                //
+//                                                                                           //
+// The update, the order of the operations and the random numbers of chain c are exactly     //
+// those of a single chain with update_mode 1, n_overrelax 0, cluster_mode 0 and the seed    //
+// seed + c, so every chain is bit-identical to that run (start_random 1). Every chain       //
+// writes its configurations to its own directory "path_read/chain_c/" (or ensemble file     //
+// "path_read/chain_c/ensemble_file").                                                       //
+//                                                                                           //
+//*******************************************************************************************//
+
+// State of one thread of the team started by chains_metropolis() (see (III.)):
+struct chains_worker {
+  long k_begin, k_end;                // lattice points [k_begin, k_end) of both parities
+  double *u_proposal, *u_accept;      // random numbers of all hits, points and chains
+  double *b_re, *b_im;                // neighbour sum of every chain at the current point
+  double *x_re, *x_im;                // field of every chain at the current point
+  double *new_re, *new_im, *deltaS;   // proposal of every chain and its change of the action
+  long *n_acc;                        // accepted hits of every chain
+};
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   The chains start from a random configuration with their own seed (start_random 1, as    //
+//   initialize_field() in "scalar.cpp") or from the field phi. chains_save() writes every   //
+//                          chain to its directory or ensemble file:                         //
+//                                                                                           //
+//###########################################################################################//
+
+int init_chains(chain_set *cs, scalar_field phi) {
+
+  struct stat st = {0};
+  char filename[1024];
+  double *u;
+  long ipt;
+  int c;
+
+  memset(cs, 0, sizeof(chain_set));
+  cs->n      = n_chain;
+  cs->re     = (double *) malloc((long) volume*cs->n * sizeof(double));
+  cs->im     = (double *) malloc((long) volume*cs->n * sizeof(double));
+  cs->buffer = (scalar_field) malloc(volume * sizeof(complex));
+  cs->output = (chain_output *) calloc(cs->n, sizeof(chain_output));
+  cs->obs    = (chain_observables *) calloc(cs->n, sizeof(chain_observables));
+  cs->n_acc  = (long *) calloc(cs->n, sizeof(long));
+
+  if(start_random == 1) {
+    u = (double *) malloc(2*(long) volume*cs->n * sizeof(double));
+    rng_uniform_lanes(seed, cs->n, 0, rng_init, NULL, 0, volume, u);
+
+    for(ipt=0;ipt<volume*(long) cs->n;ipt++) {
+      cs->re[ipt] = cos(2 * PI * u[2*ipt]);
+      cs->im[ipt] = sin(2 * PI * u[2*ipt]);
+    }
+    free(u);
+  }
+  else {
+    for(ipt=0;ipt<volume;ipt++) {
+      for(c=0;c<cs->n;c++) {
+	cs->re[ipt*cs->n + c] = phi[ipt].re;
+	cs->im[ipt*cs->n + c] = phi[ipt].im;
+      }
+    }
+  }
+
+  for(c=0;c<cs->n;c++) {
+    snprintf(cs->output[c].path, sizeof(cs->output[c].path), "%s/chain_%d", path_read, c);
+    if(stat(cs->output[c].path, &st) == -1) {
+      mkdir(cs->output[c].path, 0700);
+    }
+    if(ensemble_file[0] != '\0') {
+      snprintf(filename, sizeof(filename), "%s/%s", cs->output[c].path, ensemble_file);
+      ensemble_open_append(filename, &cs->output[c].ens);
+    }
+  }
+  printf("%d chains with the seeds %d,...,%d \n", cs->n, seed, seed + cs->n-1);
+  return 0;
+}
+
+void free_chains(chain_set *cs) {
+
+  int c;
+
+  if(ensemble_file[0] != '\0') {
+    for(c=0;c<cs->n;c++) {
+      ensemble_close(&cs->output[c].ens);
+    }
+  }
+  free(cs->re);
+  free(cs->im);
+  free(cs->buffer);
+  free(cs->output);
+  free(cs->obs);
+  free(cs->n_acc);
+}
+
+void chains_save(chain_set *cs, long long n_conf) {
+
+  const char *path = path_read;
+  long ipt;
+  int c;
+
+  for(c=0;c<cs->n;c++) {
+
+    for(ipt=0;ipt<volume;ipt++) {
+      cs->buffer[ipt].re = cs->re[ipt*cs->n + c];
+      cs->buffer[ipt].im = cs->im[ipt*cs->n + c];
+    }
+
+    path_read = cs->output[c].path;
+    if(ensemble_file[0] != '\0') {
+      if(ensemble_find(&cs->output[c].ens, n_conf) < 0) {
+	ensemble_append(&cs->output[c].ens, cs->buffer, n_conf, (field_format == 2 ? 4 : 8));
+      }
+    }
+    else if(field_format == 0) {
+      fprint_field(cs->buffer, n_conf);
+    }
+    else {
+      fprint_field_binary(cs->buffer, n_conf, (field_format == 2 ? 4 : 8));
+    }
+  }
+  path_read = path;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   The part [k_begin, k_end) of one checkerboard sweep "step" of all chains (see           //
+//   metropolis_sweep() and update_site() in "metropolis.cpp"). The random numbers of hit h  //
+//   of chain c at the point k are u_proposal[2*((h*n_k + k-k_begin)*n + c)] and             //
+//   u_proposal[...+1], u_accept[2*(((h/2)*n_k + k-k_begin)*n + c) + h%2] (see               //
+//   rng_pair_index() in "rng.h"). The neighbour sums, the proposals and the changes of the  //
+//   action are computed for all chains at once, only the accept/reject decisions are made   //
+//                                      one by one:                                          //
+//                                                                                           //
+//###########################################################################################//
+
+static void chains_sweep(chain_set *cs, long long step, chains_worker *w) {
+
+  int const n = cs->n;
+  long const n_k = w->k_end - w->k_begin;
+  double const kappa = KAPPA, lambda = LAMBDA, delta = deltarho;
+  double *b_re = w->b_re, *b_im = w->b_im, *x_re = w->x_re, *x_im = w->x_im;
+  double *new_re = w->new_re, *new_im = w->new_im, *deltaS = w->deltaS;
+  long k;
+  int ipt, parity, hit, mu, c;
+
+  for(parity=0;parity<2;parity++) {
+
+    for(hit=0;hit<n_hit;hit++) {
+      rng_uniform_lanes(seed, n, step, rng_hit_purpose(rng_proposal,hit),
+			parity_sites[parity] + w->k_begin, 0, n_k, w->u_proposal + 2*n_k*n*hit);
+    }
+    for(hit=0;hit<n_hit;hit+=2) {
+      rng_uniform_lanes(seed, n, step, rng_hit_purpose(rng_accept,hit),
+			parity_sites[parity] + w->k_begin, 0, n_k, w->u_accept + n_k*n*hit);
+    }
+
+    for(k=w->k_begin;k<w->k_end;k++) {
+
+      ipt = parity_sites[parity][k];
+      double *re = cs->re + (long) ipt*n, *im = cs->im + (long) ipt*n;
+
+      // Neighbour sums in the order of neighbour_sum() (see "action.h"):
+#pragma omp simd
+      for(c=0;c<n;c++) {
+	b_re[c] = 0.;
+	b_im[c] = 0.;
+	x_re[c] = re[c];
+	x_im[c] = im[c];
+      }
+      for(mu=0;mu<n_neighbours;mu++) {
+	double const *nb_re = cs->re + (long) neighbour(ipt,mu)*n;
+	double const *nb_im = cs->im + (long) neighbour(ipt,mu)*n;
+#pragma omp simd
+	for(c=0;c<n;c++) {
+	  b_re[c] += nb_re[c];
+	  b_im[c] += nb_im[c];
+	}
+      }
+
+      for(hit=0;hit<n_hit;hit++) {
+	double const *u_p = w->u_proposal + 2*((hit*n_k + k-w->k_begin)*n);
+	double const *u_a = w->u_accept + 2*(((hit/2)*n_k + k-w->k_begin)*n) + rng_pair_index(hit);
+
+#pragma omp simd
+	for(c=0;c<n;c++) {
+	  // local_delta_action_at() written out, complex locals are not vectorised by omp simd:
+	  double const p_re = x_re[c] - delta + 2*delta * u_p[2*c];
+	  double const p_im = x_im[c] - delta + 2*delta * u_p[2*c+1];
+	  double const rho_old = x_re[c]*x_re[c] + x_im[c]*x_im[c], rho_new = p_re*p_re + p_im*p_im;
+
+	  new_re[c] = p_re;
+	  new_im[c] = p_im;
+	  deltaS[c] = (lambda*(rho_new - 1)*(rho_new - 1) + rho_new)
+	    - (lambda*(rho_old - 1)*(rho_old - 1) + rho_old)
+	    - 2*kappa*((p_re - x_re[c])*b_re[c] + (p_im - x_im[c])*b_im[c]);
+	}
+
+	for(c=0;c<n;c++) {
+	  if(exp(-deltaS[c]) > u_a[2*c]) {
+	    x_re[c] = new_re[c];
+	    x_im[c] = new_im[c];
+	    w->n_acc[c]++;
+	  }
+	}
+      }
+
+#pragma omp simd
+      for(c=0;c<n;c++) {
+	re[c] = x_re[c];
+	im[c] = x_im[c];
+      }
+    }
+
+    // Phase barrier: all sites of one parity are updated before the next parity starts
+#pragma omp barrier
+  }
+}
+
+// Observables of all chains (see eval_observables() in "action.cpp"), lattice point by
+// lattice point for all chains at once:
+static void measure_chains(chain_set *cs) {
+
+  int const n = cs->n;
+  double rho, hop;
+  long ipt;
+  int mu, c;
+
+  for(c=0;c<n;c++) {
+    cs->obs[c].action           = 0.;
+    cs->obs[c].phi2             = 0.;
+    cs->obs[c].hopping          = 0.;
+    cs->obs[c].magnetisation.re = 0.;
+    cs->obs[c].magnetisation.im = 0.;
+  }
+
+  for(ipt=0;ipt<volume;ipt++) {
+    double const *re = cs->re + ipt*n, *im = cs->im + ipt*n;
+
+    for(c=0;c<n;c++) {
+      rho = re[c]*re[c] + im[c]*im[c];
+      hop = 0.;
+      for(mu=0;mu<4;mu++) {
+	hop += re[c]*cs->re[(long) neighbour(ipt,mu)*n + c] + im[c]*cs->im[(long) neighbour(ipt,mu)*n + c];
+      }
+      cs->obs[c].action           += LAMBDA*(rho - 1)*(rho - 1) + rho - 2*KAPPA*hop;
+      cs->obs[c].phi2             += rho;
+      cs->obs[c].hopping          += hop;
+      cs->obs[c].magnetisation.re += re[c];
+      cs->obs[c].magnetisation.im += im[c];
+    }
+  }
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   n_field sweeps of all chains with one team of threads (the sweep "step" is keyed by     //
+//   sweep_count + step as in metropolis()). The observables of every chain are printed and  //
+//        their actions written to faction, the mean acceptance is returned:                 //
+//                                                                                           //
+//###########################################################################################//
+
+double chains_metropolis(chain_set *cs, int n_field, FILE *faction) {
+
+  int const n = cs->n;
+  long n_acc = 0;
+  int c;
+  double time0 = omp_get_wtime();
+
+  memset(cs->n_acc, 0, n * sizeof(long));
+
+#pragma omp parallel
+  {
+    chains_worker w;
+    int pid = omp_get_thread_num(), nthreads = omp_get_num_threads();
+    int step;
+
+    w.k_begin = (volume/2) * (long) pid / nthreads;
+    w.k_end   = (volume/2) * (long) (pid+1) / nthreads;
+
+    w.u_proposal = (double *) malloc(2*(long) n_hit*(w.k_end-w.k_begin)*n * sizeof(double));
+    w.u_accept   = (double *) malloc(2*(long) n_hit*(w.k_end-w.k_begin)*n * sizeof(double));
+    w.b_re   = (double *) malloc(n * sizeof(double));
+    w.b_im   = (double *) malloc(n * sizeof(double));
+    w.x_re   = (double *) malloc(n * sizeof(double));
+    w.x_im   = (double *) malloc(n * sizeof(double));
+    w.new_re = (double *) malloc(n * sizeof(double));
+    w.new_im = (double *) malloc(n * sizeof(double));
+    w.deltaS = (double *) malloc(n * sizeof(double));
+    w.n_acc  = (long *) calloc(n, sizeof(long));
+
+    for(step=0;step<n_field;step++) {
+      chains_sweep(cs, sweep_count + step, &w);
+    }
+
+#pragma omp critical
+    for(int c=0;c<n;c++) {
+      cs->n_acc[c] += w.n_acc[c];
+    }
+
+    free(w.u_proposal);
+    free(w.u_accept);
+    free(w.b_re);
+    free(w.b_im);
+    free(w.x_re);
+    free(w.x_im);
+    free(w.new_re);
+    free(w.new_im);
+    free(w.deltaS);
+    free(w.n_acc);
+  }
+  sweep_count += n_field;
+
+  double time1 = omp_get_wtime();
+
+  measure_chains(cs);
+
+  printf("=====================================================\n");
+  printf("Chains = %d, sweeps = %d \n", n, n_field);
+  for(c=0;c<n;c++) {
+    printf("chain %d: action = %f, <|phi|^2> = %f, |<phi>| = %f, acceptance = %f \n", c,
+	   cs->obs[c].action, cs->obs[c].phi2/volume,
+	   sqrt(cs->obs[c].magnetisation.re*cs->obs[c].magnetisation.re +
+		cs->obs[c].magnetisation.im*cs->obs[c].magnetisation.im)/volume,
+	   (double) cs->n_acc[c]/((double) n_field*volume*n_hit));
+    if(faction != NULL) {
+      fprintf(faction, "%e%s", cs->obs[c].action, (c < n-1 ? " " : "\n"));
+    }
+    n_acc += cs->n_acc[c];
+  }
+  printf("chain sweeps per second = %f \n", (double) n*n_field/(time1-time0));
+
+  return (double) n_acc/((double) n*n_field*volume*n_hit);
+}
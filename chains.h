@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "types.h"
+#include "action.h"
+#include "ensemble.h"
+
+// Output of one chain: directory of its configurations and its ensemble file (if ensemble_file
+// is set, see "parameters.h"):
+struct chain_output {
+  char path[512];
+  ensemble ens;
+};
+
+// n_chain independent Markov chains with the seeds seed, seed+1, ... stored as interleaved
+// lanes (see "chains.cpp"): the field of chain c at the lattice point ipt is
+// (re[ipt*n + c], im[ipt*n + c]):
+struct chain_set {
+  int n;                        // n_chain
+  double *re, *im;
+  scalar_field buffer;          // one chain in the layout of scalar_field (for the output)
+  chain_output *output;
+  chain_observables *obs;       // observables of every chain, measured after every call
+  long *n_acc;                  // accepted hits of every chain in the current call
+};
+
+int init_chains(chain_set *cs, scalar_field phi);
+void free_chains(chain_set *cs);
+double chains_metropolis(chain_set *cs, int n_field, FILE *faction);
+void chains_save(chain_set *cs, long long n_conf);
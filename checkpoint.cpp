@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "types.h"
+#include "parameters.h"
+#include "field_io.h"
+#include "metropolis.h"
+#include "checkpoint.h"
+#include "generator_singleton.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// A checkpoint file consists of a checkpoint_header, the states of the mt19937 generators   //
+// (update_mode 0, as text of rng_bytes characters), the field as a record of the binary     //
+// format (see "field_io.h") and, with n_autocorr > 0, the sums of the autocorr_n_obs time   //
+// series of the online analysis (see "autocorr.h"), from which save_tau_factor sets the     //
+// steps between the saved configurations. The random numbers of the checkerboard sweeps     //
+// only depend on seed and sweep_count (see "rng.h"), and n_metropolis_calls keeps the       //
+// schedule of n_action_check, so a resumed chain continues bit by bit like the original     //
+// one. The file is written under a temporary name and renamed when it is complete, a run    //
+// killed during write_checkpoint() leaves the previous checkpoint intact.                   //
+//                                                                                           //
+//*******************************************************************************************//
+
+#define checkpoint_magic "PHI4CKPT"
+#define checkpoint_version 4
+
+struct checkpoint_header {
+  char magic[8];          // checkpoint_magic
+  uint32_t version;       // checkpoint_version
+  int32_t seed;
+  int32_t t, x, y, z;     // lattice size T, X, Y, Z
+  int32_t update_mode;
+  int32_t thermalised;
+  int64_t sweep_count;
+  int64_t n_saved;
+  int64_t action_bytes;
+  int64_t n_steps;
+  int32_t n_steps_save;
+  int32_t reserved2;
+  double deltarho;
+  int32_t hmc_n_steps;
+  int32_t reserved;
+  double observables[5];  // running action, |phi|^2, hopping term, magnetisation (re, im)
+  int64_t observables_valid;
+  int64_t metropolis_calls;  // n_metropolis_calls (see "metropolis.h")
+  int32_t n_autocorr;        // n_autocorr of the series following the field (0: none)
+  int32_t autocorr_w_max;
+  uint64_t rng_bytes;     // length of the mt19937 states following the header
+};
+
+// Sums of one time series of the online autocorrelation analysis (see "autocorr.h"):
+static int fwrite_autocorr_series(FILE *fs, autocorr_series const *s) {
+
+  int64_t n = s->n;
+  size_t const w = s->w_max;
+
+  return (fwrite(&n, sizeof(n), 1, fs) == 1 && fwrite(&s->shift, sizeof(double), 1, fs) == 1 &&
+	  fwrite(&s->sum, sizeof(double), 1, fs) == 1 &&
+	  fwrite(s->first, sizeof(double), w, fs) == w && fwrite(s->last, sizeof(double), w, fs) == w &&
+	  fwrite(s->lag_sum, sizeof(double), w+1, fs) == w+1) ? 0 : -1;
+}
+
+static int fread_autocorr_series(FILE *fs, autocorr_series *s) {
+
+  int64_t n;
+  size_t const w = s->w_max;
+
+  if(fread(&n, sizeof(n), 1, fs) != 1 || fread(&s->shift, sizeof(double), 1, fs) != 1 ||
+     fread(&s->sum, sizeof(double), 1, fs) != 1 ||
+     fread(s->first, sizeof(double), w, fs) != w || fread(s->last, sizeof(double), w, fs) != w ||
+     fread(s->lag_sum, sizeof(double), w+1, fs) != w+1) {
+    return -1;
+  }
+  s->n = n;
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//                                Write a checkpoint:                                        //
+//                                                                                           //
+//###########################################################################################//
+
+int write_checkpoint(const char *filename, scalar_field phi, chain_state const *p_state) {
+
+  checkpoint_header header;
+  std::string rng_state = GeneratorSingleton::save_state();
+  char tmp_filename[512];
+  FILE *fs;
+  int status, k;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, checkpoint_magic, 8);
+  header.version      = checkpoint_version;
+  header.seed         = seed;
+  header.t = T;
+  header.x = X;
+  header.y = Y;
+  header.z = Z;
+  header.update_mode  = update_mode;
+  header.thermalised  = p_state->thermalised;
+  header.sweep_count  = sweep_count;
+  header.n_saved      = p_state->n_saved;
+  header.action_bytes = p_state->action_bytes;
+  header.n_steps      = p_state->n_steps;
+  header.n_steps_save = p_state->n_steps_save;
+  header.deltarho     = deltarho;
+  header.hmc_n_steps  = hmc_n_steps;
+  header.observables[0] = observables.action;
+  header.observables[1] = observables.phi2;
+  header.observables[2] = observables.hopping;
+  header.observables[3] = observables.magnetisation.re;
+  header.observables[4] = observables.magnetisation.im;
+  header.observables_valid = observables_valid;
+  header.metropolis_calls  = n_metropolis_calls;
+  header.n_autocorr     = (p_state->series != NULL ? n_autocorr : 0);
+  header.autocorr_w_max = (p_state->series != NULL ? autocorr_w_max : 0);
+  header.rng_bytes    = rng_state.size();
+
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+  fs = fopen(tmp_filename, "wb");
+  if(fs == NULL) {
+    printf("Failed to open %s\n", tmp_filename);
+    exit(1);
+  }
+
+  status = (fwrite(&header, sizeof(header), 1, fs) == 1 &&
+	    fwrite(rng_state.data(), 1, rng_state.size(), fs) == rng_state.size() &&
+	    fwrite_field_record(fs, phi, sweep_count, 8) == 0) ? 0 : -1;
+  for(k=0;k<autocorr_n_obs && header.n_autocorr > 0 && status == 0;k++) {
+    status = fwrite_autocorr_series(fs, &p_state->series[k]);
+  }
+  if(status == 0 && (fflush(fs) != 0 || fsync(fileno(fs)) != 0)) {
+    status = -1;
+  }
+  fclose(fs);
+
+  if(status != 0 || rename(tmp_filename, filename) != 0) {
+    printf("Failed to write the checkpoint %s\n", filename);
+    exit(1);
+  }
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   Read a checkpoint into phi and *p_state (with the time series p_state->series) and      //
+//   restore seed, deltarho, hmc_n_steps (both possibly tuned, see "tune.cpp"), sweep_count, //
+//                    n_metropolis_calls and the mt19937 generators:                         //
+//                                                                                           //
+//###########################################################################################//
+
+int read_checkpoint(const char *filename, scalar_field phi, chain_state *p_state) {
+
+  checkpoint_header header;
+  std::string rng_state;
+  long long n_conf;
+  int k;
+  FILE *fs = fopen(filename, "rb");
+
+  if(fs == NULL) {
+    printf("Failed to open the checkpoint %s\n", filename);
+    exit(1);
+  }
+
+  if(fread(&header, sizeof(header), 1, fs) != 1 || memcmp(header.magic, checkpoint_magic, 8) != 0) {
+    printf("%s is not a checkpoint\n", filename);
+    exit(1);
+  }
+  // Every change of checkpoint_header increases checkpoint_version, other layouts are not read:
+  if(header.version != checkpoint_version) {
+    printf("%s has the checkpoint version %u, this program reads version %d\n", filename,
+	   header.version, checkpoint_version);
+    exit(1);
+  }
+  if(header.t != T || header.x != X || header.y != Y || header.z != Z ||
+     header.update_mode != update_mode) {
+    printf("%s was written for T=%d X=%d Y=%d Z=%d update_mode=%d\n", filename,
+	   header.t, header.x, header.y, header.z, header.update_mode);
+    exit(1);
+  }
+  // The time series continue only with the same measurements (see "autocorr.h"):
+  if(header.n_autocorr != (p_state->series != NULL ? n_autocorr : 0) ||
+     (header.n_autocorr > 0 && header.autocorr_w_max != autocorr_w_max)) {
+    printf("%s was written with n_autocorr=%d autocorr_w_max=%d\n", filename,
+	   header.n_autocorr, header.autocorr_w_max);
+    exit(1);
+  }
+
+  rng_state.resize(header.rng_bytes);
+  if(fread(&rng_state[0], 1, header.rng_bytes, fs) != header.rng_bytes ||
+     fread_field_record(fs, phi, &n_conf) != 0 || n_conf != header.sweep_count) {
+    printf("The checkpoint %s is damaged\n", filename);
+    exit(1);
+  }
+  for(k=0;k<autocorr_n_obs && header.n_autocorr > 0;k++) {
+    if(fread_autocorr_series(fs, &p_state->series[k]) != 0) {
+      printf("The checkpoint %s is damaged\n", filename);
+      exit(1);
+    }
+  }
+  fclose(fs);
+
+  if(header.seed != seed) {
+    printf("Continuing the chain of the checkpoint with seed = %d\n", header.seed);
+  }
+  seed        = header.seed;
+  deltarho    = header.deltarho;
+  hmc_n_steps = header.hmc_n_steps;
+  sweep_count = header.sweep_count;
+
+  // The running observables continue as in the original chain (see "metropolis.h"):
+  observables.action           = header.observables[0];
+  observables.phi2             = header.observables[1];
+  observables.hopping          = header.observables[2];
+  observables.magnetisation.re = header.observables[3];
+  observables.magnetisation.im = header.observables[4];
+  observables_valid            = header.observables_valid;
+  n_metropolis_calls           = header.metropolis_calls;
+
+  if(GeneratorSingleton::load_state(rng_state) != omp_get_max_threads() && update_mode == 0) {
+    printf("Warning: the checkpoint was written with a different number of threads\n");
+  }
+
+  p_state->n_saved      = header.n_saved;
+  p_state->thermalised  = header.thermalised;
+  p_state->action_bytes = header.action_bytes;
+  p_state->n_steps      = header.n_steps;
+  p_state->n_steps_save = header.n_steps_save;
+  return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "types.h"
+#include "autocorr.h"
+
+// Progress of the Markov chain of "calculate_toytest.cpp". Together with the field, the seed,
+// deltarho, hmc_n_steps, sweep_count, n_metropolis_calls, the running observables (see
+// "metropolis.h") and the mt19937 states it is stored in a checkpoint (see "checkpoint.cpp"):
+struct chain_state {
+  long long n_saved;       // number of configurations saved so far
+  int thermalised;         // the thermalisation of a hot start is done
+  long long action_bytes;  // length of "action.out" (the action history) at the checkpoint
+  long long n_steps;       // update steps since the thermalisation (trajectory of the last saved
+                           // configuration without start_random_conf)
+  int n_steps_save;        // current steps between saved configurations (see save_tau_factor)
+  autocorr_series *series; // the autocorr_n_obs series of the online analysis (n_autocorr > 0,
+                           // see "autocorr.h"), NULL without it
+};
+
+int write_checkpoint(const char *filename, scalar_field phi, chain_state const *p_state);
+int read_checkpoint(const char *filename, scalar_field phi, chain_state *p_state);
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <random>
+
+#include "types.h"
+#include "parameters.h"
+#include "geometry.h"
+#include "action.h"
+#include "rng.h"
+#include "generator_singleton.h"
+#include "cluster.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Embedding of an Ising model into the O(2) symmetric field: for a random unit vector r,    //
+// the reflection phi -> phi - 2*a*r with a = Re(phi^* r) flips the sign of the component a  //
+// along r and keeps |phi|^2, so only the hopping term of the action changes. The link       //
+// x,y contributes -2*KAPPA*a_x*a_y to the action, flipping one of its ends costs            //
+// 4*KAPPA*a_x*a_y. Bonds are set with probability 1 - exp(-4*KAPPA*a_x*a_y) on links with   //
+// a_x*a_y > 0 and the clusters of bonded lattice points are flipped as a whole. No accept/  //
+// reject step is needed.                                                                    //
+//                                                                                           //
+// The random numbers of the update "update" of the step "step" are taken from the counter-  //
+// based generator (update_mode 1, see "rng.h") with the purposes                            //
+// rng_hit_purpose(rng_cluster,3*update + i): i = 0 for the direction r and the first point  //
+// of a Wolff cluster (site volume) and the flips of the Swendsen-Wang clusters (site of the //
+// root), i = 1,2 for the bonds of a lattice point in the forward directions 0,1 and 2,3.    //
+// For update_mode 0 they are drawn from the mersenne twister of the calling thread.         //
+//                                                                                           //
+//*******************************************************************************************//
+
+static inline double cluster_random(long long step, int purpose, long site, int i) {
+
+  double u[2];
+
+  if(update_mode == 1) {
+    rng_uniform(step, purpose, site, u);
+    return u[i];
+  }
+  return std::uniform_real_distribution<double>(0.0,1.0)(GeneratorSingleton::get());
+}
+
+int init_cluster_workspace(cluster_workspace *cw) {
+
+  memset(cw, 0, sizeof(cluster_workspace));
+
+  cw->member     = (int *) malloc(volume * sizeof(int));
+  cw->in_cluster = (char *) calloc(volume, sizeof(char));
+
+  if(cluster_mode == cluster_swendsen_wang) {
+    cw->parent    = (int *) malloc(volume * sizeof(int));
+    cw->a         = (double *) malloc(volume * sizeof(double));
+    cw->u_bond[0] = (double *) malloc(2*volume * sizeof(double));
+    cw->u_bond[1] = (double *) malloc(2*volume * sizeof(double));
+  }
+  return 0;
+}
+
+void free_cluster_workspace(cluster_workspace *cw) {
+
+  free(cw->member);
+  free(cw->in_cluster);
+  free(cw->parent);
+  free(cw->a);
+  free(cw->u_bond[0]);
+  free(cw->u_bond[1]);
+}
+
+void print_cluster_statistics(cluster_workspace const *cw) {
+
+  if(cw->n_updates == 0) return;
+
+  if(cluster_mode == cluster_wolff) {
+    printf("Wolff clusters: <|C|>/V = %f \n", (double) cw->n_flipped/cw->n_updates/volume);
+  }
+  else {
+    printf("Swendsen-Wang clusters: %f per update, <max |C|>/V = %f, flipped = %f \n",
+	   (double) cw->n_clusters/cw->n_updates, (double) cw->max_size/cw->n_updates/volume,
+	   (double) cw->n_flipped/cw->n_updates/volume);
+  }
+}
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Add the change of the observables by flipping the lattice points with in_cluster[x]!=0  //
+//   (members member[0,...,n] for Wolff, all lattice points for Swendsen-Wang) to *delta     //
+//   and flip them. Only links with one flipped end change the hopping term:                 //
+//                                                                                           //
+//###########################################################################################//
+
+static void flip_cluster(scalar_field phi, complex r, int const *member, long n,
+			 char const *in_cluster, chain_observables *delta) {
+
+  long k;
+  int x, y, mu;
+  double a_x, delta_hopping = 0, delta_a = 0;
+
+  for(k=0;k<n;k++) {
+    x = (member != NULL ? member[k] : k);
+    if(!in_cluster[x]) continue;
+
+    a_x = phi[x].re*r.re + phi[x].im*r.im;
+    for(mu=0;mu<n_neighbours;mu++) {
+      y = neighbour(x,mu);
+      if(!in_cluster[y]) {
+	delta_hopping -= 2*a_x*(phi[y].re*r.re + phi[y].im*r.im);
+      }
+    }
+    delta_a -= 2*a_x;
+  }
+
+  for(k=0;k<n;k++) {
+    x = (member != NULL ? member[k] : k);
+    if(!in_cluster[x]) continue;
+
+    a_x = phi[x].re*r.re + phi[x].im*r.im;
+    phi[x].re -= 2*a_x*r.re;
+    phi[x].im -= 2*a_x*r.im;
+  }
+
+  delta->action           -= 2*KAPPA*delta_hopping;
+  delta->hopping          += delta_hopping;
+  delta->magnetisation.re += delta_a*r.re;
+  delta->magnetisation.im += delta_a*r.im;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   Wolff single cluster update: the cluster is grown from a random lattice point. The      //
+//   lattice points of the cluster member[0,...,n) are also the queue of the points whose    //
+//   neighbours are still to be tested. Every link is tested at most once:                   //
+//                                                                                           //
+//###########################################################################################//
+
+static long wolff_update(scalar_field phi, long long step, int hit, complex r, int x0,
+			 cluster_workspace *cw, chain_observables *delta) {
+
+  long head = 0, n = 0, k;
+  int x, y, mu;
+  double a_x, a_y, u;
+
+  cw->member[n++] = x0;
+  cw->in_cluster[x0] = 1;
+
+  while(head < n) {
+    x = cw->member[head++];
+    a_x = phi[x].re*r.re + phi[x].im*r.im;
+
+    for(mu=0;mu<n_neighbours;mu++) {
+      y = neighbour(x,mu);
+      if(cw->in_cluster[y]) continue;
+
+      a_y = phi[y].re*r.re + phi[y].im*r.im;
+      if(a_x*a_y <= 0) continue;
+
+      // The random number of the link belongs to its lattice point in backward direction:
+      if(mu < 4) {
+	u = cluster_random(step, rng_hit_purpose(rng_cluster, hit + 1 + mu/2), x, mu%2);
+      }
+      else {
+	u = cluster_random(step, rng_hit_purpose(rng_cluster, hit + 1 + (mu-4)/2), y, mu%2);
+      }
+
+      if(u < 1 - exp(-4*KAPPA*a_x*a_y)) {
+	cw->member[n++] = y;
+	cw->in_cluster[y] = 1;
+      }
+    }
+  }
+
+  flip_cluster(phi, r, cw->member, n, cw->in_cluster, delta);
+
+  for(k=0;k<n;k++) {
+    cw->in_cluster[cw->member[k]] = 0;
+  }
+
+  cw->n_clusters++;
+  cw->n_flipped += n;
+  cw->max_size  += n;
+  return n;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Swendsen-Wang update: all bonds of the lattice are set, the clusters are found with a   //
+//   union-find tree (parent[x] == x for the root, the root is the smallest lattice point    //
+//   of the cluster) and every cluster is flipped with probability 1/2:                      //
+//                                                                                           //
+//###########################################################################################//
+
+static inline int find_root(int *parent, int x) {
+
+  while(parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+static long swendsen_wang_update(scalar_field phi, long long step, int hit, complex r,
+				 cluster_workspace *cw, chain_observables *delta) {
+
+  long k, n_clusters = 0, max_size = 0, n_flipped = 0;
+  int x, y, mu, root_x, root_y;
+  double a_x, a_y, u;
+
+  for(x=0;x<volume;x++) {
+    cw->a[x] = phi[x].re*r.re + phi[x].im*r.im;
+    cw->parent[x] = x;
+    cw->member[x] = 0;
+  }
+
+  if(update_mode == 1) {
+    rng_uniform_bulk(step, rng_hit_purpose(rng_cluster, hit + 1), NULL, 0, volume, cw->u_bond[0]);
+    rng_uniform_bulk(step, rng_hit_purpose(rng_cluster, hit + 2), NULL, 0, volume, cw->u_bond[1]);
+  }
+  else {
+    for(k=0;k<4*(long) volume;k++) {
+      cw->u_bond[k%4/2][k/4*2 + k%2] = cluster_random(step, 0, 0, 0);
+    }
+  }
+
+  // Bonds in the forward directions mu = 0,1,2,3 of every lattice point:
+  for(x=0;x<volume;x++) {
+    a_x = cw->a[x];
+    for(mu=0;mu<4;mu++) {
+      y = neighbour(x,mu);
+      a_y = cw->a[y];
+      if(a_x*a_y <= 0) continue;
+
+      u = cw->u_bond[mu/2][2*x + mu%2];
+      if(u < 1 - exp(-4*KAPPA*a_x*a_y)) {
+	root_x = find_root(cw->parent, x);
+	root_y = find_root(cw->parent, y);
+	if(root_x < root_y) cw->parent[root_y] = root_x;
+	if(root_y < root_x) cw->parent[root_x] = root_y;
+      }
+    }
+  }
+
+  // The roots are visited before all other points of their cluster:
+  for(x=0;x<volume;x++) {
+    root_x = find_root(cw->parent, x);
+    if(root_x == x) {
+      n_clusters++;
+      cw->in_cluster[x] = (cluster_random(step, rng_hit_purpose(rng_cluster, hit), x, 0) < 0.5);
+    }
+    else {
+      cw->in_cluster[x] = cw->in_cluster[root_x];
+    }
+    cw->member[root_x]++;
+    n_flipped += cw->in_cluster[x];
+  }
+
+  for(x=0;x<volume;x++) {
+    if(cw->member[x] > max_size) max_size = cw->member[x];
+  }
+
+  flip_cluster(phi, r, NULL, volume, cw->in_cluster, delta);
+  memset(cw->in_cluster, 0, volume * sizeof(char));
+
+  cw->n_clusters += n_clusters;
+  cw->n_flipped  += n_flipped;
+  cw->max_size   += max_size;
+  return n_flipped;
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//   One cluster update (number "update" of the step "step") of the algorithm cluster_mode   //
+//   with a random direction r. The changes of the observables are added to *delta (see      //
+//      "action.h"), the number of flipped lattice points is returned:                       //
+//                                                                                           //
+//###########################################################################################//
+
+int cluster_update(scalar_field phi, long long step, int update, cluster_workspace *cw,
+		   chain_observables *delta) {
+
+  int hit = 3*update;
+  double angle = 2*PI*cluster_random(step, rng_hit_purpose(rng_cluster, hit), volume, 0);
+  complex r(cos(angle), sin(angle));
+  long n_flipped = 0;
+  int x0;
+
+  if(cluster_mode == cluster_wolff) {
+    x0 = (int) (volume*cluster_random(step, rng_hit_purpose(rng_cluster, hit), volume, 1));
+    if(x0 >= volume) x0 = volume-1;
+    n_flipped = wolff_update(phi, step, hit, r, x0, cw, delta);
+  }
+  else if(cluster_mode == cluster_swendsen_wang) {
+    n_flipped = swendsen_wang_update(phi, step, hit, r, cw, delta);
+  }
+  cw->n_updates++;
+  return (int) n_flipped;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+#include "action.h"
+
+// Embedded Ising cluster updates of the phase of phi (see "cluster.cpp"). The algorithm is
+// chosen by the parameter cluster_mode (see "parameters.h"):
+enum cluster_algorithm {
+  cluster_off           = 0,
+  cluster_wolff         = 1,   // single cluster grown from a random lattice point
+  cluster_swendsen_wang = 2    // all clusters of the lattice, each flipped with probability 1/2
+};
+
+// Buffers of the cluster updates and their statistics, set up by init_cluster_workspace():
+struct cluster_workspace {
+  int *member;         // Wolff: lattice points of the cluster, SW: size of the cluster of a root
+  int *parent;         // SW: union-find tree of the clusters
+  char *in_cluster;    // Wolff: lattice point is in the cluster, SW: lattice point is flipped
+  double *a;           // SW: projection of phi on the direction of the update
+  double *u_bond[2];   // SW: random numbers of the bonds in the directions 0,1 and 2,3
+
+  long n_updates;      // number of cluster updates
+  long n_clusters;     // number of clusters (Wolff: one per update)
+  long long n_flipped; // number of flipped lattice points
+  long long max_size;  // sum of the sizes of the largest cluster of each update
+};
+
+int init_cluster_workspace(cluster_workspace *cw);
+void free_cluster_workspace(cluster_workspace *cw);
+void print_cluster_statistics(cluster_workspace const *cw);
+int cluster_update(scalar_field phi, long long step, int update, cluster_workspace *cw,
+		   chain_observables *delta);
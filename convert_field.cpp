@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "parameters.h"
+#include "scalar.h"
+#include "field_io.h"
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Convert one text configuration "scalar_X_Y_Z_T_(n_conf).txt" (see fprint_field() in     //
+//  "scalar.cpp") into the binary file "scalar_X_Y_Z_T_(n_conf).bin" (see "field_io.cpp").   //
+//    The lattice size and n_conf are taken from the file name if it has this form, else     //
+//                     from the parameters T,X,Y,Z (see "parameters.h"):                     //
+//                                                                                           //
+//###########################################################################################//
+
+static int convert_file(const char *filename, int precision, int t0, int x0, int y0, int z0) {
+
+  const char *base = strrchr(filename, '/');
+  char filename_bin[512];
+  long long n_conf = 0;
+  int x,y,z,t;
+  size_t length = strlen(filename);
+  scalar_field phi;
+
+  base = (base == NULL ? filename : base+1);
+
+  if(sscanf(base, "scalar_%d_%d_%d_%d_%lld.txt", &x,&y,&z,&t,&n_conf) == 5) {
+    X = x; Y = y; Z = z; T = t;
+  }
+  else {
+    X = x0; Y = y0; Z = z0; T = t0;
+  }
+  volume = T*X*Y*Z;
+
+  if(length > 4 && strcmp(filename+length-4, ".txt") == 0) {
+    length -= 4;
+  }
+  if(length + 5 > sizeof(filename_bin)) {
+    printf("File name too long: %s\n", filename);
+    exit(1);
+  }
+  memcpy(filename_bin, filename, length);
+  strcpy(filename_bin+length, ".bin");
+
+  phi = (scalar_field) calloc(volume, sizeof(complex));
+  fread_field(filename, &phi);
+  fwrite_field_binary(filename_bin, phi, n_conf, precision);
+  free(phi);
+
+  printf("%s -> %s (T=%d X=%d Y=%d Z=%d n_conf=%lld)\n", filename, filename_bin, T,X,Y,Z, n_conf);
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//                    CONVERSION OF TEXT INTO BINARY FIELD CONFIGURATIONS:                   //
+//                                                                                           //
+//   Usage: ./convert [--float] [--name value ...] file.txt ... directory ...                //
+//   Every given directory (e.g. "start_config/" or "path_read") is searched for text        //
+//   configurations "scalar_*.txt". "--float" stores single precision data. m2_0 and         //
+//   lambda_c (for LAMBDA, KAPPA in the header) and T,X,Y,Z (for files without the lattice   //
+//   size in their name) are given as for "./toytest" (see "parameters.cpp"):                //
+//                                                                                           //
+//###########################################################################################//
+
+int main(int argc, char *argv[]) {
+
+  int i, n_options = 1, precision = 8;
+  char **options = (char **) malloc((argc+1) * sizeof(char *));
+  char path[1024];
+  struct stat st;
+  DIR *dir;
+  struct dirent *entry;
+  size_t length;
+
+  //=========================================================================================//
+  // (II.A)                                                                                  //
+  // Separate the parameters ("--name value", passed to read_parameters()) from the files:   //
+  //                                                                                         //
+  //=========================================================================================//
+
+  options[0] = argv[0];
+  for(i=1;i<argc;i++) {
+    if(strcmp(argv[i], "--float") == 0) {
+      precision = 4;
+    }
+    else if(strncmp(argv[i], "-", 1) == 0 && i+1 < argc) {
+      options[n_options++] = argv[i];
+      options[n_options++] = argv[++i];
+    }
+  }
+  options[n_options] = NULL;
+
+  read_parameters(n_options, options);
+  calculate_parameters();
+
+  int t0 = T, x0 = X, y0 = Y, z0 = Z;
+
+  //=========================================================================================//
+  // (II.B)                                                                                  //
+  // Convert all given files and all text configurations in the given directories:           //
+  //                                                                                         //
+  //=========================================================================================//
+
+  for(i=1;i<argc;i++) {
+
+    if(strcmp(argv[i], "--float") == 0) continue;
+    if(strncmp(argv[i], "-", 1) == 0) {
+      i++;
+      continue;
+    }
+
+    if(stat(argv[i], &st) != 0) {
+      printf("Failed to open %s\n", argv[i]);
+      exit(1);
+    }
+
+    if(!S_ISDIR(st.st_mode)) {
+      convert_file(argv[i], precision, t0,x0,y0,z0);
+      continue;
+    }
+
+    dir = opendir(argv[i]);
+    while((entry = readdir(dir)) != NULL) {
+      length = strlen(entry->d_name);
+      if(strncmp(entry->d_name, "scalar_", 7) == 0 && length > 4 &&
+	 strcmp(entry->d_name+length-4, ".txt") == 0) {
+	snprintf(path, sizeof(path), "%s/%s", argv[i], entry->d_name);
+	convert_file(path, precision, t0,x0,y0,z0);
+      }
+    }
+    closedir(dir);
+  }
+
+  free(options);
+  return 0;
+}
@@ -7,99 +7,236 @@
 
 #include "complex.h"
 #include "types.h"
+#include "correlators.h"
 #include "action.h"
 #include "parameters.h"
 #include "scalar.h"
+#include "geometry.h"
+#include "soa_field.h"
 
 
 
-/* The declarations of complex n particle correlation function correlator_n(...)
-   is embedded into "operators.h". */
+/* The n particle correlation functions are built in two stages: every configuration is
+   projected once onto all requested momenta (project_field(), O(T*V)), and all correlators
+   and their finite differences are built from the T-length projected fields
+   (correlator_n_all(), O(T^2) per n). */
 
 //####################################################################################//
 // (I.)                                                                               //
-//     Calculate the n particle correlation function "C_{nphi}(t) = correlator_n".    //
-//   (The integer n_aux runs from 1 up to n_fields (see "calculate_corr.cpp"(II.E))   //
-//         and is the number of particles in the finite volume, respectively):        //
+//   Plane waves exp(i p x) of the n_momenta momenta (px,py,pz) = momenta[3*ip+0,1,2] //
+//   at all spatial points. They are computed once and reused for all configurations: //
 //                                                                                    //
 //####################################################################################//
 
+int init_projector(momentum_projector *p_proj, int n_momenta, int const *momenta) {
 
-complex correlator_n(scalar_field phi, long n_aux, int dt, int px, int py, int pz) {
-  
-  int t1,x,y,z;
-  
-  complex phi_t_sink, phi_t_source;
-  complex exp_ipx;
-  complex aux_source, aux_sink;
-  complex operator_sink, operator_source;
-  complex corr;
-
-  corr.re = 0.;
-  corr.im = 0.;
+  int ip,x,y,z,ispace;
+  int px,py,pz;
 
-  for(t1=0;t1<T;t1++) {
-    
-    phi_t_source.re = 0.;
-    phi_t_source.im = 0.;
-    phi_t_sink.re = 0.;
-    phi_t_sink.im = 0.;
-    
+  p_proj->n_momenta = n_momenta;
+  p_proj->momenta   = (int *) malloc(3*n_momenta * sizeof(int));
+  p_proj->phase_re  = (double *) malloc(n_momenta*X*Y*Z * sizeof(double));
+  p_proj->phase_im  = (double *) malloc(n_momenta*X*Y*Z * sizeof(double));
+  memcpy(p_proj->momenta, momenta, 3*n_momenta * sizeof(int));
+  soa_alloc(&p_proj->buffer);
+  p_proj->block_sum = (double *) malloc(2*soa_reduction_blocks*T * sizeof(double));
+
+  for(ip=0;ip<n_momenta;ip++) {
+
+    px = momenta[3*ip];
+    py = momenta[3*ip+1];
+    pz = momenta[3*ip+2];
+
+    ispace = ip*X*Y*Z;
     for(x=0;x<X;x++) {
       for(y=0;y<Y;y++) {
 	for(z=0;z<Z;z++) {
-	  
-	  exp_ipx.re = cos(2*PI*((double) px*x/X + (double) py*y/Y + (double) pz*z/Z));
-	  exp_ipx.im = sin(2*PI*((double) px*x/X + (double) py*y/Y + (double) pz*z/Z));
-
-	  
-	  //==========================================================================//
-	  // (I.A)                                                                    //
-	  // Calculate a single summand of the sink field phi(k_1) without            //
-	  // the prefactor 1/T, i.e. "phi(\vec{x}_1,t1) exp(...)":                    //
-	  //                                                                          //
-	  //==========================================================================//
-	  
-	  aux_sink   = prod_complex(exp_ipx, phi[lattice_point(t1,x,y,z)]);
-	  phi_t_sink.re +=   aux_sink.re/(X*Y*Z);
-	  phi_t_sink.im +=   aux_sink.im/(X*Y*Z);	  
-
-	  
-	  //==========================================================================//
-	  // (I.B)                                                                    //
-	  // Calculate a single summand of the source field phi(k_2) without          //
-	  // the prefactor 1/T, i.e. "phi(\vec{x}_2,t1+dt) exp(...)":                 //
-	  //                                                                          //
-	  //==========================================================================//
-	  
-	  aux_source  = prod_complex(exp_ipx, phi[lattice_point((t1+dt)%T,x,y,z)]);
-	  phi_t_source.re +=  aux_source.re/(X*Y*Z);
-	  phi_t_source.im +=  aux_source.im/(X*Y*Z);
-	  
+	  p_proj->phase_re[ispace] = cos(2*PI*((double) px*x/X + (double) py*y/Y + (double) pz*z/Z));
+	  p_proj->phase_im[ispace] = sin(2*PI*((double) px*x/X + (double) py*y/Y + (double) pz*z/Z));
+	  ispace++;
 	}
       }
     }
+  }
+  return 0;
+}
+
+void free_projector(momentum_projector *p_proj) {
+
+  free(p_proj->momenta);
+  free(p_proj->phase_re);
+  free(p_proj->phase_im);
+  soa_free(&p_proj->buffer);
+  free(p_proj->block_sum);
+  p_proj->n_momenta = 0;
+}
+
+
+
+//####################################################################################//
+// (II.)                                                                              //
+//   Project a configuration once onto all momenta of the projector: phi(t,p) =       //
+//   1/(X*Y*Z) sum_{x,y,z} phi(\vec{x},t) exp(i p x) for all t (vectorised, see       //
+//   "soa_field.cpp"). This is the only step whose cost grows with the volume:        //
+//                                                                                    //
+//####################################################################################//
+
+int project_field(momentum_projector *p_proj, scalar_field phi, projected_field *p_phi_t) {
+
+  int ip,t;
+  double *sum_re = (double *) malloc(T * sizeof(double));
+  double *sum_im = (double *) malloc(T * sizeof(double));
+
+  if(p_phi_t->phi_t == NULL || p_phi_t->n_momenta != p_proj->n_momenta) {
+    free(p_phi_t->phi_t);
+    p_phi_t->n_momenta = p_proj->n_momenta;
+    p_phi_t->phi_t = (complex *) malloc(p_proj->n_momenta*T * sizeof(complex));
+  }
+
+  soa_from_field(&p_proj->buffer, phi);
+
+  for(ip=0;ip<p_proj->n_momenta;ip++) {
+
+    soa_timeslice_sum(&p_proj->buffer, p_proj->phase_re + ip*X*Y*Z, p_proj->phase_im + ip*X*Y*Z,
+		      sum_re, sum_im, p_proj->block_sum);
+
+    for(t=0;t<T;t++) {
+      p_phi_t->phi_t[ip*T + t].re = sum_re[t]/(X*Y*Z);
+      p_phi_t->phi_t[ip*T + t].im = sum_im[t]/(X*Y*Z);
+    }
+  }
+
+  free(sum_re);
+  free(sum_im);
+  return 0;
+}
+
+void free_projected_field(projected_field *p_phi_t) {
+
+  free(p_phi_t->phi_t);
+  p_phi_t->phi_t = NULL;
+  p_phi_t->n_momenta = 0;
+}
+
+
+
+//####################################################################################//
+// (III.)                                                                             //
+//     Calculate the n particle correlation function "C_{nphi}(dt) = correlator_n"    //
+//   for all dt = 0,...,T-1 from the projected field of the momentum ip. (The integer //
+//   n_aux runs from 1 up to n_fields (see "calculate_corr.cpp"(II.E)) and is the     //
+//             number of particles in the finite volume, respectively):               //
+//                                                                                    //
+//####################################################################################//
+
+// Time average of operator_t[t1] * conjugate(operator_t[t1+dt]) for all dt = 0,...,T-1:
+static void correlate_operator(complex const *operator_t, complex *corr) {
+
+  int t1,dt;
+  complex aux;
+
+  for(dt=0;dt<T;dt++) {
+
+    corr[dt].re = 0.;
+    corr[dt].im = 0.;
+
+    for(t1=0;t1<T;t1++) {
+      aux = prod_complex(operator_t[t1], conjugate(operator_t[(t1+dt)%T]));
+      corr[dt].re += aux.re/T;
+      corr[dt].im += aux.im/T;
+    }
+  }
+}
+
+void correlator_n_all(projected_field const *p_phi_t, int ip, long n_aux, complex *corr) {
+
+  int t1;
+  complex const *phi_t = p_phi_t->phi_t + ip*T;
+  complex *operator_t = (complex *) malloc(T * sizeof(complex));
+
+  //==================================================================================//
+  // (III.A)                                                                          //
+  // Calculate the n particle operator of every time slice once (it is the sink       //
+  // operator at t1 and the source operator at t1+dt):                                //
+  //                                                                                  //
+  //==================================================================================//
+
+  for(t1=0;t1<T;t1++) {
+    operator_t[t1] = pow(phi_t[t1], n_aux);
+  }
+
+  //==================================================================================//
+  // (III.B)                                                                          //
+  // Calculate the n particle correlation function (real and imaginary part):         //
+  //                                                                                  //
+  //==================================================================================//
+
+  correlate_operator(operator_t, corr);
+
+  free(operator_t);
+}
+
+
+
+//####################################################################################//
+// (IV.)                                                                              //
+//   All n particle correlation functions n = 1,...,n_max of the momentum ip at once: //
+//   corr[(n-1)*T + dt]. The operators are built by a power ladder                    //
+//   phi^n(t) = phi^(n-1)(t) * phi(t) instead of a complex power per n:               //
+//                                                                                    //
+//####################################################################################//
+
+void correlator_ladder(projected_field const *p_phi_t, int ip, long n_max, complex *corr) {
 
-    //================================================================================//
-    // (I.C)                                                                          //
-    // Calculate the n particle sink and source operator:                             //
-    //                                                                                //
-    //================================================================================//
-    
-    operator_sink   = pow(phi_t_sink, n_aux);
-    operator_source = pow(phi_t_source, n_aux);
-    
-    
-    //================================================================================//
-    // (I.D)                                                                          //
-    // Calculate the n particle correlation function (real and imaginary part):       //
-    //                                                                                //
-    //================================================================================//
-    
-    corr.re += (prod_complex(operator_sink, conjugate(operator_source)).re/T);
-    corr.im += (prod_complex(operator_sink, conjugate(operator_source)).im/T);
+  int t1;
+  long n;
+  complex const *phi_t = p_phi_t->phi_t + ip*T;
+  complex *operator_t = (complex *) malloc(T * sizeof(complex));
 
+  for(t1=0;t1<T;t1++) {
+    operator_t[t1] = phi_t[t1];
+  }
+
+  for(n=1;n<=n_max;n++) {
+
+    if(n > 1) {
+      for(t1=0;t1<T;t1++) {
+	operator_t[t1] = prod_complex(operator_t[t1], phi_t[t1]);
+      }
     }
-  
-  return corr;
+
+    correlate_operator(operator_t, corr + (n-1)*T);
+  }
+
+  free(operator_t);
+}
+
+
+
+//####################################################################################//
+// (V.)                                                                               //
+//   The n particle correlation function at a single dt and momentum (px,py,pz) of    //
+//   a single configuration. Since the projection (II.) is done at every call, the    //
+//   analysis of many dt should use project_field() and correlator_n_all() instead:   //
+//                                                                                    //
+//####################################################################################//
+
+complex correlator_n(scalar_field phi, long n_aux, int dt, int px, int py, int pz) {
+
+  int momentum[3] = {px, py, pz};
+  momentum_projector proj;
+  projected_field phi_t = {0, NULL};
+  complex *corr = (complex *) malloc(T * sizeof(complex));
+  complex result;
+
+  init_projector(&proj, 1, momentum);
+  project_field(&proj, phi, &phi_t);
+  correlator_n_all(&phi_t, 0, n_aux, corr);
+
+  result = corr[((dt%T)+T)%T];
+
+  free(corr);
+  free_projected_field(&phi_t);
+  free_projector(&proj);
+  return result;
 }
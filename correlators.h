@@ -1,2 +1,32 @@
-complex correlator_n(scalar_field phi, long n_aux, int t, int px, int py, int pz);
+#pragma once
+
+#include "complex.h"
+#include "types.h"
+#include "soa_field.h"
+
+// Plane waves exp(i p x) of all spatial points for a set of momenta p = 2 pi (px/X, py/Y, pz/Z),
+// computed once by init_projector() (see "correlators.cpp"):
+struct momentum_projector {
+  int n_momenta;
+  int *momenta;          // momenta[3*ip + 0,1,2] = px, py, pz
+  double *phase_re;      // phase_re[ip*X*Y*Z + (x*Y + y)*Z + z]
+  double *phase_im;
+  soa_field buffer;      // the configuration in the layout of the projection kernel
+  double *block_sum;     // partial sums of soa_timeslice_sum() (see "soa_field.h")
+};
+
+// Projection phi(t,p) = 1/(X*Y*Z) sum_{x,y,z} exp(i p x) phi(t,x,y,z) of one configuration:
+struct projected_field {
+  int n_momenta;
+  complex *phi_t;        // phi_t[ip*T + t]
+};
 
+int init_projector(momentum_projector *p_proj, int n_momenta, int const *momenta);
+void free_projector(momentum_projector *p_proj);
+
+int project_field(momentum_projector *p_proj, scalar_field phi, projected_field *p_phi_t);
+void free_projected_field(projected_field *p_phi_t);
+
+void correlator_n_all(projected_field const *p_phi_t, int ip, long n_aux, complex *corr);
+void correlator_ladder(projected_field const *p_phi_t, int ip, long n_max, complex *corr);
+complex correlator_n(scalar_field phi, long n_aux, int t, int px, int py, int pz);
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parameters.h"
+#include "ensemble.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// An ensemble file holds all configurations of a Markov chain one after another, so that    //
+// 100000 configurations are one file instead of 100000. "toytest" appends a record after    //
+// every n_term_save steps (see ensemble_append()), "corr" maps the whole file once and      //
+// reads any record through the index without opening further files (see ensemble_get()).    //
+// The index "<filename>.idx" is appended after its record. If a run is killed in between,   //
+// the missing entries are recovered from the record headers when the file is opened again.  //
+//                                                                                           //
+//*******************************************************************************************//
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//                       Helper functions for the in-memory index:                           //
+//                                                                                           //
+//###########################################################################################//
+
+static void index_add(ensemble *p_ens, long long n_conf, uint64_t offset) {
+
+  if(p_ens->n_conf == p_ens->n_alloc) {
+    p_ens->n_alloc = (p_ens->n_alloc == 0 ? 64 : 2*p_ens->n_alloc);
+    p_ens->index = (ensemble_index_entry *) realloc(p_ens->index,
+						    p_ens->n_alloc * sizeof(ensemble_index_entry));
+  }
+  if(p_ens->n_conf > 0 && p_ens->index[p_ens->n_conf-1].trajectory >= n_conf) {
+    p_ens->sorted = 0;
+  }
+  p_ens->index[p_ens->n_conf].trajectory = n_conf;
+  p_ens->index[p_ens->n_conf].offset     = offset;
+  p_ens->n_conf++;
+}
+
+static uint64_t record_size(field_header const *header) {
+
+  uint64_t size = sizeof(field_header) + header->data_bytes;
+  return (size + ensemble_record_alignment - 1) / ensemble_record_alignment * ensemble_record_alignment;
+}
+
+// Read the index file and recover the entries of records behind the last indexed record from
+// their headers. The number of recovered entries is returned (they are not yet in the file):
+static int load_index(ensemble *p_ens, FILE *file, uint64_t file_size) {
+
+  char filename_idx[520];
+  FILE *index_file;
+  ensemble_index_entry entry;
+  field_header header;
+  uint64_t offset = 0;
+  int n_recovered = 0;
+
+  p_ens->n_conf = 0;
+  p_ens->sorted = 1;
+
+  snprintf(filename_idx, sizeof(filename_idx), "%s.idx", p_ens->filename);
+  index_file = fopen(filename_idx, "rb");
+
+  if(index_file != NULL) {
+    while(fread(&entry, sizeof(entry), 1, index_file) == 1 && entry.offset < file_size) {
+      index_add(p_ens, entry.trajectory, entry.offset);
+    }
+    fclose(index_file);
+  }
+
+  if(p_ens->n_conf > 0) {
+    fseeko(file, p_ens->index[p_ens->n_conf-1].offset, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, file) != 1) {
+      printf("Failed to read %s\n", p_ens->filename);
+      exit(1);
+    }
+    offset = p_ens->index[p_ens->n_conf-1].offset + record_size(&header);
+  }
+
+  // Complete records without index entry:
+  while(offset + sizeof(header) <= file_size) {
+    fseeko(file, offset, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, field_magic, 8) != 0 ||
+       offset + sizeof(header) + header.data_bytes > file_size) {
+      break;
+    }
+    index_add(p_ens, header.trajectory, offset);
+    offset += record_size(&header);
+    n_recovered++;
+  }
+  return n_recovered;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//    Open (or create) the ensemble file "filename" for appending. Index entries of records  //
+//      written by a killed run are recovered. ensemble_append() adds the field phi with     //
+//     trajectory number n_conf in double (precision 8) or single (precision 4) precision:   //
+//                                                                                           //
+//###########################################################################################//
+
+int ensemble_open_append(const char *filename, ensemble *p_ens) {
+
+  char filename_idx[520];
+  int n_recovered, k;
+  uint64_t file_size;
+
+  memset(p_ens, 0, sizeof(*p_ens));
+  snprintf(p_ens->filename, sizeof(p_ens->filename), "%s", filename);
+  snprintf(filename_idx, sizeof(filename_idx), "%s.idx", filename);
+
+  p_ens->file = fopen(filename, "a+b");
+  if(p_ens->file == NULL) {
+    printf("Failed to open %s\n", filename);
+    exit(1);
+  }
+  fseeko(p_ens->file, 0, SEEK_END);
+  file_size = ftello(p_ens->file);
+
+  n_recovered = load_index(p_ens, p_ens->file, file_size);
+
+  // Rewrite the index if entries had to be recovered or were beyond the end of the file:
+  p_ens->index_file = fopen(filename_idx, (n_recovered > 0 ? "wb" : "ab"));
+  if(p_ens->index_file == NULL) {
+    printf("Failed to open %s\n", filename_idx);
+    exit(1);
+  }
+  if(n_recovered > 0) {
+    for(k=0;k<p_ens->n_conf;k++) {
+      fwrite(&p_ens->index[k], sizeof(ensemble_index_entry), 1, p_ens->index_file);
+    }
+    fflush(p_ens->index_file);
+    printf("Recovered %d index entries of %s\n", n_recovered, filename);
+  }
+  return 0;
+}
+
+int ensemble_append(ensemble *p_ens, scalar_field phi, long long n_conf, int precision) {
+
+  static const char padding[ensemble_record_alignment] = {0};
+  uint64_t offset, size;
+  ensemble_index_entry entry;
+
+  // A partially written record of a killed run is overwritten:
+  if(p_ens->n_conf > 0) {
+    field_header header;
+    fseeko(p_ens->file, p_ens->index[p_ens->n_conf-1].offset, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, p_ens->file) != 1) {
+      printf("Failed to read %s\n", p_ens->filename);
+      exit(1);
+    }
+    offset = p_ens->index[p_ens->n_conf-1].offset + record_size(&header);
+  }
+  else {
+    offset = 0;
+  }
+  if(ftruncate(fileno(p_ens->file), offset) != 0) {
+    printf("Failed to write %s\n", p_ens->filename);
+    exit(1);
+  }
+  fseeko(p_ens->file, offset, SEEK_SET);
+
+  if(fwrite_field_record(p_ens->file, phi, n_conf, precision) != 0) {
+    printf("Failed to write %s\n", p_ens->filename);
+    exit(1);
+  }
+  size = ftello(p_ens->file) - offset;
+  if(size % ensemble_record_alignment != 0) {
+    fwrite(padding, ensemble_record_alignment - size % ensemble_record_alignment, 1, p_ens->file);
+  }
+  fflush(p_ens->file);
+
+  // The index entry is only written once the record is complete:
+  entry.trajectory = n_conf;
+  entry.offset     = offset;
+  fwrite(&entry, sizeof(entry), 1, p_ens->index_file);
+  fflush(p_ens->index_file);
+
+  index_add(p_ens, n_conf, offset);
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//  Open the ensemble file "filename" for reading: the file is mapped into memory once and   //
+//   ensemble_get() returns the kth record (0 <= k < n_conf) as a mapped_field without       //
+//    copying (see "field_io.h"). ensemble_find() returns k for the trajectory number        //
+//                             n_conf (or -1 if it is missing):                              //
+//                                                                                           //
+//###########################################################################################//
+
+int ensemble_open_read(const char *filename, ensemble *p_ens) {
+
+  struct stat st;
+  FILE *file;
+  int fd;
+
+  memset(p_ens, 0, sizeof(*p_ens));
+  snprintf(p_ens->filename, sizeof(p_ens->filename), "%s", filename);
+
+  file = fopen(filename, "rb");
+  if(file == NULL || fstat(fileno(file), &st) != 0) {
+    printf("Failed to open %s\n", filename);
+    exit(1);
+  }
+  load_index(p_ens, file, st.st_size);
+  fclose(file);
+
+  if(st.st_size > 0) {
+    fd = open(filename, O_RDONLY);
+    p_ens->map_size = st.st_size;
+    p_ens->map = mmap(NULL, p_ens->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(p_ens->map == MAP_FAILED) {
+      printf("Failed to map %s\n", filename);
+      exit(1);
+    }
+  }
+  return 0;
+}
+
+int ensemble_find(ensemble const *p_ens, long long n_conf) {
+
+  int low = 0, high = p_ens->n_conf - 1, middle, k;
+
+  if(p_ens->sorted) {
+    while(low <= high) {
+      middle = (low + high)/2;
+      if(p_ens->index[middle].trajectory == n_conf) return middle;
+      if(p_ens->index[middle].trajectory < n_conf) low = middle + 1;
+      else high = middle - 1;
+    }
+    return -1;
+  }
+  for(k=0;k<p_ens->n_conf;k++) {
+    if(p_ens->index[k].trajectory == n_conf) return k;
+  }
+  return -1;
+}
+
+int ensemble_get(ensemble const *p_ens, int k, mapped_field *p_map, int verify) {
+
+  field_header const *header;
+
+  if(p_ens->map == NULL || k < 0 || k >= p_ens->n_conf) {
+    printf("Record %d is not in %s\n", k, p_ens->filename);
+    exit(1);
+  }
+
+  header = (field_header const *) ((char const *) p_ens->map + p_ens->index[k].offset);
+  check_field_header(header, p_ens->filename);
+
+  // The record belongs to the mapping of the ensemble, so unmap_field() must not be called:
+  p_map->map    = NULL;
+  p_map->size   = 0;
+  p_map->header = header;
+  p_map->data   = (char const *) header + sizeof(field_header);
+  p_map->phi    = (header->precision == 8 ? (scalar_field) p_map->data : NULL);
+
+  if(verify && field_checksum(p_map->data, header->data_bytes) != header->checksum) {
+    printf("Checksum error in record %d (n_conf=%lld) of %s\n", k,
+	   (long long) header->trajectory, p_ens->filename);
+    exit(1);
+  }
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//                  Close the files and the mapping opened in (II.) or (III.):               //
+//                                                                                           //
+//###########################################################################################//
+
+void ensemble_close(ensemble *p_ens) {
+
+  if(p_ens->file != NULL) fclose(p_ens->file);
+  if(p_ens->index_file != NULL) fclose(p_ens->index_file);
+  if(p_ens->map != NULL) munmap(p_ens->map, p_ens->map_size);
+  free(p_ens->index);
+  memset(p_ens, 0, sizeof(*p_ens));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+#include "field_io.h"
+
+// Append-only container of many binary configurations (see "ensemble.cpp"). The records are
+// complete binary configurations (field_header + data, see "field_io.h"), each padded to a
+// multiple of ensemble_record_alignment bytes. The index file "<filename>.idx" holds one
+// ensemble_index_entry per record.
+#define ensemble_record_alignment 64
+
+struct ensemble_index_entry {
+  int64_t trajectory;
+  uint64_t offset;
+};
+
+struct ensemble {
+  char filename[512];
+  FILE *file;                       // opened by ensemble_open_append(), else NULL
+  FILE *index_file;
+  int n_conf;                       // number of records
+  int n_alloc;
+  ensemble_index_entry *index;      // trajectory number -> offset of the record
+  int sorted;                       // 1 if the trajectory numbers increase
+  void *map;                        // mapping created by ensemble_open_read(), else NULL
+  size_t map_size;
+};
+
+int ensemble_open_append(const char *filename, ensemble *p_ens);
+int ensemble_append(ensemble *p_ens, scalar_field phi, long long n_conf, int precision);
+
+int ensemble_open_read(const char *filename, ensemble *p_ens);
+int ensemble_find(ensemble const *p_ens, long long n_conf);
+int ensemble_get(ensemble const *p_ens, int k, mapped_field *p_map, int verify);
+
+void ensemble_close(ensemble *p_ens);
@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "parameters.h"
+#include "soa_field.h"
+#include "fft.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Complex FFT of the field over the periodic lattice of lattice_point(t,x,y,z) (see         //
+// "scalar.cpp"), without external libraries. The four directions are transformed one after  //
+// the other. The lines of one direction are copied in batches into a buffer of the thread,  //
+// transformed by the Stockham autosort algorithm (no bit reversal) and copied back; the     //
+// batches are split across the threads. The lattice sizes we run factorise into 2, 3, 4 and //
+// 7 (6 = 2*3, 8 = 4*2, 14 = 2*7, 24 = 4*3*2, 48 = 4*4*3), radix 2 and 4 have explicit       //
+// butterflies, all other primes up to fft_max_radix a direct DFT of the length of the radix.//
+//                                                                                           //
+//*******************************************************************************************//
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//       Plan of a one-dimensional FFT: factorisation of n and table of twiddle factors:     //
+//                                                                                           //
+//###########################################################################################//
+
+int init_fft_plan(fft_plan *p, int n) {
+
+  int m = n, f, s, k, r, l = 1;
+
+  memset(p, 0, sizeof(fft_plan));
+  p->n = n;
+
+  // Radix 4 first, then the primes in increasing order:
+  while(m%4 == 0) {
+    p->radix[p->n_stages++] = 4;
+    m /= 4;
+  }
+  for(f=2;m>1;f++) {
+    while(m%f == 0) {
+      if(f > fft_max_radix) {
+	printf("Lattice size %d has the prime factor %d > %d (see fft.h)\n", n, f, fft_max_radix);
+	exit(1);
+      }
+      p->radix[p->n_stages++] = f;
+      m /= f;
+    }
+  }
+
+  p->root_re = (double *) malloc(n * sizeof(double));
+  p->root_im = (double *) malloc(n * sizeof(double));
+  for(k=0;k<n;k++) {
+    p->root_re[k] = cos(2*PI*k/n);
+    p->root_im[k] = -sin(2*PI*k/n);
+  }
+
+  for(s=0;s<p->n_stages;s++) {
+    p->twiddle_re[s] = (double *) malloc(l*p->radix[s] * sizeof(double));
+    p->twiddle_im[s] = (double *) malloc(l*p->radix[s] * sizeof(double));
+    for(k=0;k<l;k++) {
+      for(r=0;r<p->radix[s];r++) {
+	p->twiddle_re[s][k*p->radix[s] + r] = cos(2*PI*k*r/(l*p->radix[s]));
+	p->twiddle_im[s][k*p->radix[s] + r] = -sin(2*PI*k*r/(l*p->radix[s]));
+      }
+    }
+    l *= p->radix[s];
+  }
+  return 0;
+}
+
+void free_fft_plan(fft_plan *p) {
+
+  int s;
+
+  for(s=0;s<p->n_stages;s++) {
+    free(p->twiddle_re[s]);
+    free(p->twiddle_im[s]);
+  }
+  free(p->root_re);
+  free(p->root_im);
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   FFT of B lines at once, element i of line b at (re, im)[i*B + b], with the scratch      //
+//   arrays (wre, wim) of the same size and (tre, tim) of fft_max_radix*B. In the stage s    //
+//   the n/radix butterflies j combine the elements j + r*n/radix (r < radix), the results   //
+//   go to (j/l)*l*radix + k + q*l (k = j%l). The sign of all imaginary parts of the twiddle //
+//   factors and roots is sigma = +1 (forward) or -1 (backward). All loops over the lines b  //
+//                     are vectorised. The result is in (re, im):                            //
+//                                                                                           //
+//###########################################################################################//
+
+static void fft_batch(fft_plan const *p, int B, double *re, double *im, double *wre,
+		      double *wim, double *tre, double *tim, int sign) {
+
+  double const sigma = (sign < 0 ? 1. : -1.);
+  double *in_re = re, *in_im = im, *out_re = wre, *out_im = wim, *swap;
+  double tw_re, tw_im, x_re, x_im, c_re, c_im, s0_re, s0_im, s1_re, s1_im, d_re, d_im;
+  int const n = p->n;
+  int s, j, k, r, q, b, radix, m, l = 1, base, step;
+
+  for(s=0;s<p->n_stages;s++) {
+
+    radix = p->radix[s];
+    m = n/radix;
+    step = n/radix;
+
+    for(j=0;j<m;j++) {
+
+      k = j%l;
+      base = (j/l)*l*radix + k;
+
+      // Elements multiplied by the twiddle factors exp(-+ 2 pi i k r/(l*radix)):
+      for(r=0;r<radix;r++) {
+	double const *src_re = in_re + (j + r*m)*B, *src_im = in_im + (j + r*m)*B;
+	double *dst_re = tre + r*B, *dst_im = tim + r*B;
+
+	tw_re = p->twiddle_re[s][k*radix + r];
+	tw_im = sigma*p->twiddle_im[s][k*radix + r];
+#pragma omp simd
+	for(b=0;b<B;b++) {
+	  dst_re[b] = src_re[b]*tw_re - src_im[b]*tw_im;
+	  dst_im[b] = src_re[b]*tw_im + src_im[b]*tw_re;
+	}
+      }
+
+      double *o_re = out_re + base*B, *o_im = out_im + base*B;
+
+      if(radix == 2) {
+#pragma omp simd
+	for(b=0;b<B;b++) {
+	  o_re[b]     = tre[b] + tre[B+b];
+	  o_im[b]     = tim[b] + tim[B+b];
+	  o_re[l*B+b] = tre[b] - tre[B+b];
+	  o_im[l*B+b] = tim[b] - tim[B+b];
+	}
+      }
+      else if(radix == 4) {
+#pragma omp simd private(c_re, c_im, s0_re, s0_im, s1_re, s1_im, d_re, d_im)
+	for(b=0;b<B;b++) {
+	  s0_re = tre[b] + tre[2*B+b];
+	  s0_im = tim[b] + tim[2*B+b];
+	  d_re  = tre[b] - tre[2*B+b];
+	  d_im  = tim[b] - tim[2*B+b];
+	  s1_re = tre[B+b] + tre[3*B+b];
+	  s1_im = tim[B+b] + tim[3*B+b];
+	  // (a1 - a3) multiplied by -+i:
+	  c_re  =  sigma*(tim[B+b] - tim[3*B+b]);
+	  c_im  = -sigma*(tre[B+b] - tre[3*B+b]);
+	  o_re[b]       = s0_re + s1_re;
+	  o_im[b]       = s0_im + s1_im;
+	  o_re[l*B+b]   = d_re + c_re;
+	  o_im[l*B+b]   = d_im + c_im;
+	  o_re[2*l*B+b] = s0_re - s1_re;
+	  o_im[2*l*B+b] = s0_im - s1_im;
+	  o_re[3*l*B+b] = d_re - c_re;
+	  o_im[3*l*B+b] = d_im - c_im;
+	}
+      }
+      else {
+	// Direct DFT of length radix with the roots exp(-+ 2 pi i r q/radix):
+	for(q=0;q<radix;q++) {
+	  double *dst_re = o_re + q*l*B, *dst_im = o_im + q*l*B;
+
+	  memcpy(dst_re, tre, B*sizeof(double));
+	  memcpy(dst_im, tim, B*sizeof(double));
+	  for(r=1;r<radix;r++) {
+	    tw_re = p->root_re[(r*q)%radix * step];
+	    tw_im = sigma*p->root_im[(r*q)%radix * step];
+#pragma omp simd private(x_re, x_im)
+	    for(b=0;b<B;b++) {
+	      x_re = tre[r*B+b];
+	      x_im = tim[r*B+b];
+	      dst_re[b] += x_re*tw_re - x_im*tw_im;
+	      dst_im[b] += x_re*tw_im + x_im*tw_re;
+	    }
+	  }
+	}
+      }
+    }
+
+    l *= radix;
+    swap = in_re; in_re = out_re; out_re = swap;
+    swap = in_im; in_im = out_im; out_im = swap;
+  }
+
+  if(in_re != re) {
+    memcpy(re, in_re, n*B*sizeof(double));
+    memcpy(im, in_im, n*B*sizeof(double));
+  }
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   FFT over the lattice. In x, y and z (stride S = Y*Z*T, Z*T, T between neighbouring      //
+//   points) the T lines of one row are transformed together, so every element of the lines  //
+//   is a contiguous copy of T values. In t the lines are the rows themselves, fft_batch_t   //
+//                              rows are transposed and transformed together:                //
+//                                                                                           //
+//###########################################################################################//
+
+#define fft_batch_t 8
+
+int init_lattice_fft(lattice_fft *f) {
+
+  init_fft_plan(&f->plan[0], T);
+  init_fft_plan(&f->plan[1], X);
+  init_fft_plan(&f->plan[2], Y);
+  init_fft_plan(&f->plan[3], Z);
+  return 0;
+}
+
+void free_lattice_fft(lattice_fft *f) {
+
+  int mu;
+
+  for(mu=0;mu<4;mu++) {
+    free_fft_plan(&f->plan[mu]);
+  }
+}
+
+void lattice_fft_apply(lattice_fft const *f, soa_field *p_field, int sign) {
+
+  int const length[4] = {T, X, Y, Z};
+  int const stride[4] = {1, Y*Z*T, Z*T, T};
+  int const n_rows = volume/T;
+  int const B_max = (T > fft_batch_t ? T : fft_batch_t);
+  int L_max = 1, mu;
+
+  for(mu=0;mu<4;mu++) {
+    if(length[mu] > L_max) L_max = length[mu];
+  }
+
+#pragma omp parallel
+  {
+    double *buffer = (double *) malloc((4*L_max + 2*fft_max_radix)*B_max * sizeof(double));
+    double *re = buffer, *im = re + L_max*B_max, *wre = im + L_max*B_max;
+    double *wim = wre + L_max*B_max, *tre = wim + L_max*B_max, *tim = tre + fft_max_radix*B_max;
+    int batch, start, i, b, B, L, S, nu;
+
+    // t: rows batch*fft_batch_t,... (element i of row b at re[i*B + b])
+    if(T > 1) {
+#pragma omp for schedule(static)
+      for(batch=0;batch<(n_rows + fft_batch_t-1)/fft_batch_t;batch++) {
+
+	B = n_rows - batch*fft_batch_t;
+	if(B > fft_batch_t) B = fft_batch_t;
+	start = batch*fft_batch_t*T;
+
+	for(b=0;b<B;b++) {
+	  for(i=0;i<T;i++) {
+	    re[i*B + b] = p_field->re[start + b*T + i];
+	    im[i*B + b] = p_field->im[start + b*T + i];
+	  }
+	}
+
+	fft_batch(&f->plan[0], B, re, im, wre, wim, tre, tim, sign);
+
+	for(b=0;b<B;b++) {
+	  for(i=0;i<T;i++) {
+	    p_field->re[start + b*T + i] = re[i*B + b];
+	    p_field->im[start + b*T + i] = im[i*B + b];
+	  }
+	}
+      }
+    }
+
+    // x, y, z: the L lines through the row "batch" (coordinate 0 in direction nu):
+    for(nu=1;nu<4;nu++) {
+
+      L = length[nu];
+      S = stride[nu];
+      if(L == 1) continue;
+
+#pragma omp for schedule(static)
+      for(batch=0;batch<n_rows/L;batch++) {
+
+	start = (batch/(S/T))*S*L + (batch%(S/T))*T;
+
+	for(i=0;i<L;i++) {
+	  memcpy(re + i*T, p_field->re + start + i*S, T*sizeof(double));
+	  memcpy(im + i*T, p_field->im + start + i*S, T*sizeof(double));
+	}
+
+	fft_batch(&f->plan[nu], T, re, im, wre, wim, tre, tim, sign);
+
+	for(i=0;i<L;i++) {
+	  memcpy(p_field->re + start + i*S, re + i*T, T*sizeof(double));
+	  memcpy(p_field->im + start + i*S, im + i*T, T*sizeof(double));
+	}
+      }
+    }
+    free(buffer);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "soa_field.h"
+
+// Largest prime factor of a lattice size handled by the FFT (see "fft.cpp"):
+#define fft_max_radix 64
+
+// Mixed-radix plan of a one-dimensional FFT of length n = radix[0]*...*radix[n_stages-1]. The
+// twiddle factors of stage s are exp(-2 pi i k r/(l_s*radix[s])) at twiddle_re/im[s][k*radix[s]
+// + r] with l_s = radix[0]*...*radix[s-1], the roots are exp(-2 pi i q/n):
+struct fft_plan {
+  int n;
+  int n_stages;
+  int radix[32];
+  double *twiddle_re[32], *twiddle_im[32];
+  double *root_re, *root_im;
+};
+
+// FFT over the periodic lattice T,X,Y,Z (one plan per direction):
+struct lattice_fft {
+  fft_plan plan[4];
+};
+
+int init_fft_plan(fft_plan *p, int n);
+void free_fft_plan(fft_plan *p);
+int init_lattice_fft(lattice_fft *f);
+void free_lattice_fft(lattice_fft *f);
+
+// In-place transform of p_field, sign = -1 forward (sum_x e^{-ipx}), sign = +1 backward; both
+// unnormalised:
+void lattice_fft_apply(lattice_fft const *f, soa_field *p_field, int sign);
@@ -0,0 +1,303 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parameters.h"
+#include "field_io.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Binary field configuration files "scalar_X_Y_Z_T_(n_conf).bin" consist of a header        //
+// (field_header, see "field_io.h") with the lattice size, LAMBDA, KAPPA, the trajectory     //
+// number n_conf, the proposal width (deltarho, hmc_n_steps) and a checksum, followed by the //
+// raw field in the order of lattice_point().                                                //
+// In contrast to the text files of fprint_field() (see "scalar.cpp") no precision is lost   //
+// and the files can be mapped into memory without parsing (see (IV.)).                      //
+//                                                                                           //
+//*******************************************************************************************//
+
+static_assert(sizeof(field_header) == 128, "field_header must have 128 bytes");
+static_assert(sizeof(complex) == 2*sizeof(double), "complex must be two doubles");
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Checksum of the field data: FNV-1a over 64-bit words (the data always is a multiple     //
+//                                      of 8 bytes):                                         //
+//                                                                                           //
+//###########################################################################################//
+
+uint64_t field_checksum(void const *data, size_t bytes) {
+
+  uint64_t const *words = (uint64_t const *) data;
+  uint64_t hash = 14695981039346656037ULL;
+  size_t i;
+
+  for(i=0;i<bytes/8;i++) {
+    hash ^= words[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Check the header of a binary configuration against the lattice size read at runtime:
+int check_field_header(field_header const *header, const char *filename) {
+
+  if(memcmp(header->magic, field_magic, 8) != 0 || header->version != field_version ||
+     header->byte_order != field_byte_order) {
+    printf("%s is not a binary field configuration of this machine\n", filename);
+    exit(1);
+  }
+  if(header->t != T || header->x != X || header->y != Y || header->z != Z) {
+    printf("%s has the lattice size T=%d X=%d Y=%d Z=%d instead of T=%d X=%d Y=%d Z=%d\n",
+	   filename, header->t, header->x, header->y, header->z, T,X,Y,Z);
+    exit(1);
+  }
+  if((header->precision != 8 && header->precision != 4) ||
+     header->data_bytes != (uint64_t) 2*header->precision*(volume)) {
+    printf("%s has an invalid data size\n", filename);
+    exit(1);
+  }
+  return 0;
+}
+
+int is_binary_field(const char *filename) {
+
+  char magic[8];
+  FILE *file = fopen(filename, "rb");
+  int result = 0;
+
+  if(file != NULL) {
+    result = (fread(magic, 1, 8, file) == 8 && memcmp(magic, field_magic, 8) == 0);
+    fclose(file);
+  }
+  return result;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   Write the field phi with trajectory number n_conf into the binary file "filename" in    //
+//   double (precision 8) or single (precision 4) precision. fwrite_field_record() writes    //
+//  header and data at the current position of an open file (see also "ensemble.cpp") and    //
+//   fprint_field_binary() builds the file name "scalar_X_Y_Z_T_(n_conf).bin" at             //
+//                       "path_read" like fprint_field():                                    //
+//                                                                                           //
+//###########################################################################################//
+
+int fwrite_field_record(FILE *fs, scalar_field phi, long long n_conf, int precision) {
+
+  field_header header;
+  void *data;
+  float *data_float = NULL;
+  int ipt, status;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, field_magic, 8);
+  header.version    = field_version;
+  header.byte_order = field_byte_order;
+  header.precision  = (precision == 4 ? 4 : 8);
+  header.t = T;
+  header.x = X;
+  header.y = Y;
+  header.z = Z;
+  header.lambda     = LAMBDA;
+  header.kappa      = KAPPA;
+  header.trajectory = n_conf;
+  header.deltarho   = deltarho;
+  header.hmc_n_steps = hmc_n_steps;
+  header.data_bytes = (uint64_t) 2*header.precision*(volume);
+
+  if(header.precision == 8) {
+    data = phi;
+  }
+  else {
+    data_float = (float *) malloc(header.data_bytes);
+    for(ipt=0;ipt<volume;ipt++) {
+      data_float[2*ipt]   = (float) phi[ipt].re;
+      data_float[2*ipt+1] = (float) phi[ipt].im;
+    }
+    data = data_float;
+  }
+  header.checksum = field_checksum(data, header.data_bytes);
+
+  status = (fwrite(&header, sizeof(header), 1, fs) == 1 &&
+	    fwrite(data, header.data_bytes, 1, fs) == 1) ? 0 : -1;
+
+  if(header.precision == 4) {
+    free(data_float);
+  }
+  return status;
+}
+
+int fwrite_field_binary(const char *filename, scalar_field phi, long long n_conf, int precision) {
+
+  FILE *fs = fopen(filename, "wb");
+
+  if(fs == NULL) {
+    printf("Failed to open %s\n", filename);
+    exit(1);
+  }
+  if(fwrite_field_record(fs, phi, n_conf, precision) != 0) {
+    printf("Failed to write %s\n", filename);
+    exit(1);
+  }
+  fclose(fs);
+  return 0;
+}
+
+int fprint_field_binary(scalar_field phi, long long n_conf, int precision) {
+
+  char filename[256];
+
+  sprintf(filename,"%s/scalar_%d_%d_%d_%d_%lld.bin", path_read, X,Y,Z,T,n_conf);
+  printf("%s\n", filename);
+  return fwrite_field_binary(filename, phi, n_conf, precision);
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//    Read a binary configuration into the allocated field *p_phi (used by fread_field()     //
+//     in "scalar.cpp" for binary files) or a single record from an open file:               //
+//                                                                                           //
+//###########################################################################################//
+
+int fread_field_binary(const char *filename, scalar_field *p_phi) {
+
+  mapped_field map;
+  scalar_field phi = *p_phi;
+
+  map_field(filename, &map, 1);
+
+  if(map.phi != NULL) {
+    memcpy(phi, map.phi, (volume) * sizeof(complex));
+  }
+  else {
+    mapped_field_phi(&map, phi);
+  }
+  unmap_field(&map);
+  return 0;
+}
+
+// Read a record written by fwrite_field_record() at the current position of an open file
+// into phi (returns -1 if it is incomplete or damaged):
+int fread_field_record(FILE *fs, scalar_field phi, long long *p_n_conf) {
+
+  field_header header;
+  float *data_float = NULL;
+  int ipt, status = 0;
+
+  if(fread(&header, sizeof(header), 1, fs) != 1 || memcmp(header.magic, field_magic, 8) != 0 ||
+     header.data_bytes != (uint64_t) 2*header.precision*(volume)) {
+    return -1;
+  }
+  check_field_header(&header, "field record");
+
+  if(header.precision == 8) {
+    if(fread(phi, header.data_bytes, 1, fs) != 1 ||
+       field_checksum(phi, header.data_bytes) != header.checksum) {
+      status = -1;
+    }
+  }
+  else {
+    data_float = (float *) malloc(header.data_bytes);
+    if(fread(data_float, header.data_bytes, 1, fs) != 1 ||
+       field_checksum(data_float, header.data_bytes) != header.checksum) {
+      status = -1;
+    }
+    for(ipt=0;ipt<volume && status==0;ipt++) {
+      phi[ipt].re = data_float[2*ipt];
+      phi[ipt].im = data_float[2*ipt+1];
+    }
+    free(data_float);
+  }
+
+  *p_n_conf = header.trajectory;
+  return status;
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//   Map a binary configuration into memory. The pages are only read when they are used;     //
+//   with verify != 0 the checksum is checked (which touches all data once). The mapping     //
+//                         is released by unmap_field():                                     //
+//                                                                                           //
+//###########################################################################################//
+
+int map_field(const char *filename, mapped_field *p_map, int verify) {
+
+  struct stat st;
+  int fd = open(filename, O_RDONLY);
+  field_header const *header;
+
+  if(fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(field_header)) {
+    printf("Failed to open %s\n", filename);
+    exit(1);
+  }
+
+  // Copy-on-write: the field can be used as an ordinary scalar_field without changing the file
+  p_map->size = st.st_size;
+  p_map->map  = mmap(NULL, p_map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if(p_map->map == MAP_FAILED) {
+    printf("Failed to map %s\n", filename);
+    exit(1);
+  }
+
+  header = (field_header const *) p_map->map;
+  check_field_header(header, filename);
+
+  if(p_map->size < sizeof(field_header) + header->data_bytes) {
+    printf("%s is truncated\n", filename);
+    exit(1);
+  }
+
+  p_map->header = header;
+  p_map->data   = (char const *) p_map->map + sizeof(field_header);
+  p_map->phi    = (header->precision == 8 ? (scalar_field) p_map->data : NULL);
+
+  if(verify && field_checksum(p_map->data, header->data_bytes) != header->checksum) {
+    printf("Checksum error in %s\n", filename);
+    exit(1);
+  }
+  return 0;
+}
+
+// The mapped field itself (double precision) or its conversion into "buffer" (single precision):
+scalar_field mapped_field_phi(mapped_field const *p_map, scalar_field buffer) {
+
+  float const *data_float = (float const *) p_map->data;
+  int ipt;
+
+  if(p_map->phi != NULL) {
+    return p_map->phi;
+  }
+  for(ipt=0;ipt<volume;ipt++) {
+    buffer[ipt].re = data_float[2*ipt];
+    buffer[ipt].im = data_float[2*ipt+1];
+  }
+  return buffer;
+}
+
+void unmap_field(mapped_field *p_map) {
+
+  munmap(p_map->map, p_map->size);
+  p_map->map  = NULL;
+  p_map->phi  = NULL;
+  p_map->data = NULL;
+}
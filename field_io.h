@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+
+// Header of the binary field configuration format (see "field_io.cpp"). It is followed by the
+// field in the order of lattice_point(t,x,y,z), i.e. volume pairs (re, im) of doubles
+// (precision 8) or floats (precision 4). The header has 128 bytes, so that the data of a
+// mapped file is aligned for vector loads.
+#define field_magic "PHI4CONF"
+#define field_version 1
+#define field_byte_order 0x01020304
+
+struct field_header {
+  char magic[8];          // field_magic
+  uint32_t version;       // field_version
+  uint32_t byte_order;    // field_byte_order as written by the producing machine
+  uint32_t precision;     // 8 (double) or 4 (float)
+  int32_t t, x, y, z;     // lattice size T, X, Y, Z
+  uint32_t reserved0;
+  double lambda;          // LAMBDA
+  double kappa;           // KAPPA
+  int64_t trajectory;     // n_conf
+  uint64_t data_bytes;    // size of the data following the header
+  uint64_t checksum;      // field_checksum() of the data
+  double deltarho;        // proposal width of the Metropolis hits (tuned if n_tune > 0)
+  int32_t hmc_n_steps;    // steps of an HMC trajectory (tuned if n_tune > 0)
+  uint32_t reserved1;
+  char reserved[32];
+};
+
+// A binary configuration mapped into memory by map_field(). For double precision "phi" points
+// directly into the mapping (copy-on-write, no copy is made), for single precision it is NULL
+// and the data is available as "data".
+struct mapped_field {
+  void *map;
+  size_t size;
+  field_header const *header;
+  void const *data;
+  scalar_field phi;
+};
+
+uint64_t field_checksum(void const *data, size_t bytes);
+int check_field_header(field_header const *header, const char *filename);
+int is_binary_field(const char *filename);
+
+int fwrite_field_record(FILE *fs, scalar_field phi, long long n_conf, int precision);
+int fwrite_field_binary(const char *filename, scalar_field phi, long long n_conf, int precision);
+int fprint_field_binary(scalar_field phi, long long n_conf, int precision);
+int fread_field_binary(const char *filename, scalar_field *p_phi);
+int fread_field_record(FILE *fs, scalar_field phi, long long *p_n_conf);
+
+int map_field(const char *filename, mapped_field *p_map, int verify);
+scalar_field mapped_field_phi(mapped_field const *p_map, scalar_field buffer);
+void unmap_field(mapped_field *p_map);
@@ -3,7 +3,12 @@
 #include <omp.h>
 
 #include <random>
+#include <vector>
 #include <iostream>
+#include <sstream>
+#include <string>
+
+#include "parameters.h"
 
 class GeneratorSingleton {
   public:
@@ -21,13 +26,41 @@ class GeneratorSingleton {
       return generator;
     }
 
+    // The states of all generators as text (used by the checkpoints, see "checkpoint.cpp"):
+    static std::string save_state() {
+      std::ostringstream os;
+      auto &instance = get_instance();
+      os << instance.generators_.size();
+      for (auto const &generator : instance.generators_) {
+        os << ' ' << generator;
+      }
+      return os.str();
+    }
+
+    // Restores the states written by save_state(). Generators of threads that did not exist
+    // when the state was saved keep their seed. Returns the number of restored generators.
+    static int load_state(std::string const &state) {
+      std::istringstream is(state);
+      auto &instance = get_instance();
+      size_t n = 0;
+      is >> n;
+      for (size_t i = 0; i < n; ++i) {
+        Generator generator;
+        is >> generator;
+        if (i < instance.generators_.size()) {
+          instance.generators_[i] = generator;
+        }
+      }
+      return n;
+    }
+
   private:
     GeneratorSingleton() : generators_(omp_get_max_threads()) {
-      reseed(0);
+      reseed(seed);
     }
 
     void reseed(int const base_seed) {
-      for (int i = 0; i < generators_.size(); ++i) {
+      for (std::size_t i = 0; i < generators_.size(); ++i) {
         generators_[i].seed(base_seed + i);
       }
     }
@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "parameters.h"
+#include "scalar.h"
+#include "geometry.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// All periodic index arithmetic of the lattice is done once in init_geometry() (see (I.)).  //
+// Afterwards the action, the Metropolis algorithm and the correlators only read the tables  //
+// below instead of calling lattice_point() (see "scalar.cpp") with wrapped coordinates.     //
+//                                                                                           //
+//*******************************************************************************************//
+
+int *neighbour_table = NULL;
+int *parity_sites[2] = {NULL, NULL};
+int *timeslice_sites = NULL;
+int geometry_id = geometry_generic;
+int block_count[4] = {1, 1, 1, 1};
+int block_threads = 0;
+int *block_sites[2] = {NULL, NULL};
+int *block_offset[2] = {NULL, NULL};
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//    Build the neighbour table, the lists of even and odd lattice points and the lattice    //
+//  points of every time slice for the geometry T,X,Y,Z read by read_parameters() (see       //
+//   "parameters.cpp") and select the specialised kernels (geometry_id). It has to be        //
+//            called once before any field is updated or analysed:                           //
+//                                                                                           //
+//###########################################################################################//
+
+int init_geometry() {
+
+  int t,x,y,z,ipt;
+  int n_even = 0, n_odd = 0;
+
+  free_geometry();
+
+  geometry_id = geometry_generic;
+  if(T == 8 && X == 6 && Y == 6 && Z == 6) {
+    geometry_id = geometry_6_6_6_8;
+  }
+  if(T == 48 && X == 14 && Y == 14 && Z == 14) {
+    geometry_id = geometry_14_14_14_48;
+  }
+  if(T == 48 && X == 24 && Y == 24 && Z == 24) {
+    geometry_id = geometry_24_24_24_48;
+  }
+
+  // For odd volumes there is one more even than odd lattice point:
+  neighbour_table    = (int *) malloc(n_neighbours*(volume) * sizeof(int));
+  parity_sites[0]    = (int *) malloc((volume+1)/2 * sizeof(int));
+  parity_sites[1]    = (int *) malloc((volume+1)/2 * sizeof(int));
+  timeslice_sites    = (int *) malloc((volume) * sizeof(int));
+
+  if(neighbour_table == NULL || parity_sites[0] == NULL || parity_sites[1] == NULL ||
+     timeslice_sites == NULL) {
+    printf("Failed to allocate the neighbour table\n");
+    exit(1);
+  }
+
+  for(x=0;x<X;x++) {
+    for(y=0;y<Y;y++) {
+      for(z=0;z<Z;z++) {
+	for(t=0;t<T;t++) {
+
+	  ipt = lattice_point(t,x,y,z);
+
+	  neighbour_table[n_neighbours*ipt + 0] = lattice_point(t+1,x,y,z);
+	  neighbour_table[n_neighbours*ipt + 1] = lattice_point(t,x+1,y,z);
+	  neighbour_table[n_neighbours*ipt + 2] = lattice_point(t,x,y+1,z);
+	  neighbour_table[n_neighbours*ipt + 3] = lattice_point(t,x,y,z+1);
+	  neighbour_table[n_neighbours*ipt + 4] = lattice_point(t-1,x,y,z);
+	  neighbour_table[n_neighbours*ipt + 5] = lattice_point(t,x-1,y,z);
+	  neighbour_table[n_neighbours*ipt + 6] = lattice_point(t,x,y-1,z);
+	  neighbour_table[n_neighbours*ipt + 7] = lattice_point(t,x,y,z-1);
+
+	  // The loops run in memory order, so both parity lists are sorted:
+	  if((t+x+y+z)%2 == 0) {
+	    parity_sites[0][n_even++] = ipt;
+	  }
+	  else {
+	    parity_sites[1][n_odd++] = ipt;
+	  }
+
+	  timeslice_sites[t*X*Y*Z + (x*Y + y)*Z + z] = ipt;
+	}
+      }
+    }
+  }
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//                        Release the tables allocated in (I.):                              //
+//                                                                                           //
+//###########################################################################################//
+
+void free_geometry() {
+
+  free(neighbour_table);
+  free(parity_sites[0]);
+  free(parity_sites[1]);
+  free(timeslice_sites);
+
+  neighbour_table = NULL;
+  parity_sites[0] = NULL;
+  parity_sites[1] = NULL;
+  timeslice_sites = NULL;
+
+  free_blocks();
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Block decomposition of the lattice for nthreads threads (see "geometry.h"). Only        //
+//   directions of even length are split, otherwise the colouring would not be periodic.     //
+//   If possible, nthreads is factorised into the block counts, each prime factor going to   //
+//   the direction with the longest blocks. Otherwise (e.g. a prime number of threads larger //
+//   than all lattice sizes) more blocks than threads are made and some threads get one      //
+//   block more than others:                                                                 //
+//                                                                                           //
+//###########################################################################################//
+
+// Direction (with even length) with the longest blocks that can still be split into
+// count*factor + increment blocks, or -1 if there is none:
+static int longest_blocks(int const *length, int const *count, int factor, int increment) {
+
+  int mu, mu_best = -1;
+
+  for(mu=0;mu<4;mu++) {
+    if(length[mu]%2 != 0 || count[mu]*factor + increment > length[mu]) continue;
+    if(mu_best < 0 || length[mu]*count[mu_best] > length[mu_best]*count[mu]) {
+      mu_best = mu;
+    }
+  }
+  return mu_best;
+}
+
+int init_blocks(int nthreads) {
+
+  int length[4] = {T, X, Y, Z};
+  int coord[4];
+  int mu, p, rest, n_blocks, block, pid, c, ipt;
+  int *n_sites[2];
+
+  free_blocks();
+
+  //=========================================================================================//
+  // (III.A)                                                                                 //
+  // Factorise nthreads into the block counts (largest prime factors first):                 //
+  //                                                                                         //
+  //=========================================================================================//
+
+  for(mu=0;mu<4;mu++) block_count[mu] = 1;
+
+  rest = nthreads;
+  while(rest > 1) {
+
+    // Largest prime factor p of rest:
+    for(p=rest, c=2; c*c<=p; ) {
+      if(p%c == 0) p /= c;
+      else c++;
+    }
+
+    mu = longest_blocks(length, block_count, p, 0);
+    if(mu < 0) break;
+    block_count[mu] *= p;
+    rest /= p;
+  }
+
+  // No exact factorisation: split until there are at least nthreads blocks
+  if(rest > 1) {
+    for(mu=0;mu<4;mu++) block_count[mu] = 1;
+    while(block_count[0]*block_count[1]*block_count[2]*block_count[3] < nthreads &&
+	  (mu = longest_blocks(length, block_count, 1, 1)) >= 0) {
+      block_count[mu]++;
+    }
+  }
+  n_blocks = block_count[0]*block_count[1]*block_count[2]*block_count[3];
+
+  //=========================================================================================//
+  // (III.B)                                                                                 //
+  // Count the lattice points of each colour and thread, then list them in memory order:     //
+  //                                                                                         //
+  //=========================================================================================//
+
+  block_threads = nthreads;
+  for(c=0;c<2;c++) {
+    block_sites[c]  = (int *) malloc((volume) * sizeof(int));
+    block_offset[c] = (int *) calloc(nthreads+1, sizeof(int));
+    n_sites[c]      = (int *) calloc(nthreads, sizeof(int));
+  }
+
+  for(p=0;p<2;p++) {
+    for(ipt=0;ipt<volume;ipt++) {
+
+      coord[0] = ipt%T;
+      coord[3] = (ipt/T)%Z;
+      coord[2] = (ipt/(T*Z))%Y;
+      coord[1] = ipt/(T*Y*Z);
+
+      block = 0;
+      c = 0;
+      for(mu=0;mu<4;mu++) {
+	block = block*block_count[mu] + coord[mu]*block_count[mu]/length[mu];
+	if(mu == 0 || block_count[mu] > 1) c += coord[mu];
+      }
+      pid = block % nthreads;
+      c = c%2;
+
+      // First pass: count, second pass: fill
+      if(p == 0) {
+	n_sites[c][pid]++;
+      }
+      else {
+	block_sites[c][block_offset[c][pid] + n_sites[c][pid]++] = ipt;
+      }
+    }
+
+    if(p == 0) {
+      for(c=0;c<2;c++) {
+	for(pid=0;pid<nthreads;pid++) {
+	  block_offset[c][pid+1] = block_offset[c][pid] + n_sites[c][pid];
+	  n_sites[c][pid] = 0;
+	}
+      }
+    }
+  }
+
+  free(n_sites[0]);
+  free(n_sites[1]);
+
+  printf("Blocks (t,x,y,z) = (%d,%d,%d,%d) for %d threads\n",
+	 block_count[0], block_count[1], block_count[2], block_count[3], nthreads);
+  if(n_blocks < nthreads) {
+    printf("Only %d of the %d threads get a block\n", n_blocks, nthreads);
+  }
+  return 0;
+}
+
+void free_blocks() {
+
+  free(block_sites[0]);
+  free(block_sites[1]);
+  free(block_offset[0]);
+  free(block_offset[1]);
+
+  block_sites[0]  = NULL;
+  block_sites[1]  = NULL;
+  block_offset[0] = NULL;
+  block_offset[1] = NULL;
+  block_threads   = 0;
+}
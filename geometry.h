@@ -0,0 +1,76 @@
+#pragma once
+
+#include "parameters.h"
+
+// Number of nearest neighbours of a lattice point (forward and backward in t,x,y,z):
+#define n_neighbours 8
+
+// neighbour_table[n_neighbours*ipt + mu] is the lattice point next to "ipt" in direction mu,
+// where mu = 0,1,2,3 are the forward and mu = 4,5,6,7 the backward directions in t,x,y,z:
+extern int *neighbour_table;
+
+// parity_sites[p][k] (0 <= k < volume/2) are the lattice points with (t+x+y+z)%2 == p in the
+// order in which they are stored:
+extern int *parity_sites[2];
+
+// timeslice_sites[t*X*Y*Z + (x*Y + y)*Z + z] is the lattice point (t,x,y,z):
+extern int *timeslice_sites;
+
+// Lattice sizes for which the kernels are specialised at compile time (see below):
+enum {
+  geometry_generic = 0,
+  geometry_6_6_6_8,
+  geometry_14_14_14_48,
+  geometry_24_24_24_48
+};
+
+// One of the values above for the runtime geometry T,X,Y,Z, set by init_geometry():
+extern int geometry_id;
+
+// Block decomposition for the threads of the random-site updates (update_mode 0, see
+// init_blocks()): the lattice is split into block_count[mu] blocks in t,x,y,z, which are dealt
+// out round-robin to block_threads threads. The colour of a lattice point is the parity of the
+// sum of its coordinates in the split directions (t is always one of them), so lattice points
+// of one colour in different blocks are never neighbours. The points of colour c of thread
+// pid are block_sites[c][k] with block_offset[c][pid] <= k < block_offset[c][pid+1]:
+extern int block_count[4];
+extern int block_threads;
+extern int *block_sites[2];
+extern int *block_offset[2];
+
+int init_geometry();
+void free_geometry();
+int init_blocks(int nthreads);
+void free_blocks();
+
+static inline int neighbour(int ipt, int mu) {
+  return neighbour_table[n_neighbours*ipt + mu];
+}
+
+
+// Compile-time lattice size: kernels templated on this class see constant trip counts.
+template<int LT, int LX, int LY, int LZ>
+struct fixed_geometry {
+  static int t() { return LT; }
+  static int x() { return LX; }
+  static int y() { return LY; }
+  static int z() { return LZ; }
+};
+
+// Generic fallback: the lattice size T,X,Y,Z read at runtime (see "parameters.cpp").
+struct runtime_geometry {
+  static int t() { return T; }
+  static int x() { return X; }
+  static int y() { return Y; }
+  static int z() { return Z; }
+};
+
+// Calls (and returns) KERNEL<geometry>(...) with the specialised geometry matching geometry_id
+// or with runtime_geometry:
+#define DISPATCH_GEOMETRY(KERNEL, ...)                                               \
+  switch(geometry_id) {                                                               \
+  case geometry_6_6_6_8:     return KERNEL<fixed_geometry<8,6,6,6> >(__VA_ARGS__);    \
+  case geometry_14_14_14_48: return KERNEL<fixed_geometry<48,14,14,14> >(__VA_ARGS__); \
+  case geometry_24_24_24_48: return KERNEL<fixed_geometry<48,24,24,24> >(__VA_ARGS__); \
+  default:                   return KERNEL<runtime_geometry>(__VA_ARGS__);            \
+  }
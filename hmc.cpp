@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "types.h"
+#include "parameters.h"
+#include "scalar.h"
+#include "soa_field.h"
+#include "action.h"
+#include "metropolis.h"
+#include "rng.h"
+#include "fft.h"
+#include "hmc.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Hybrid Monte Carlo (update_mode 2): the real and imaginary part of every field point get  //
+// a conjugate momentum (Gaussian, H = sum_x |mom_x|^2/2 + S[phi]). One trajectory is the    //
+// molecular dynamics of H for the time hmc_tau in hmc_n_steps steps, followed by an         //
+// accept/reject step with exp(-\Delta H). Field and momenta are stored as soa_field (see    //
+// "soa_field.cpp"), so all steps stream over the lattice and are split across the threads.  //
+//                                                                                           //
+// With hmc_n_inner > 1 the local potential part of the force is integrated on a finer time  //
+// scale: every step of the hopping term contains hmc_n_inner steps of the potential term.   //
+//                                                                                           //
+// With hmc_fourier = 1 the kinetic term is sum_p K_p |mom_p|^2/2 in momentum space with     //
+// K_p = (mu^2 + 16)/(mu^2 + \hat p^2), \hat p^2 = sum_mu 4 sin^2(p_mu/2) and mu^2 =         //
+// hmc_fourier_mass2 (Fourier acceleration): the modes with small \hat p, which the field    //
+// changes slowest, move faster by up to K_0 = (mu^2 + 16)/mu^2. The momenta have the        //
+// covariance 1/K_p, the field moves with K_p mom_p. The field is complex, so the transforms //
+// are complex FFTs over the periodic lattice (see "fft.cpp").                               //
+//                                                                                           //
+// The momenta of the trajectory "step" are drawn with the purpose rng_hmc (see "rng.h"),    //
+// the accept/reject decision with rng_hit_purpose(rng_hmc,1) at site 0, so the chain does   //
+// not depend on the number of threads.                                                      //
+//                                                                                           //
+//*******************************************************************************************//
+
+// Parameter of the Omelyan integrator with the smallest error norm:
+static const double omelyan_lambda = 0.1931833275037836;
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Kernel of the Fourier acceleration and its application to a field in momentum space:    //
+//                                                                                           //
+//###########################################################################################//
+
+static void init_fourier(hmc_state *h) {
+
+  int const length[4] = {T, X, Y, Z};
+  int n[4], ipt, mu;
+  double p2, K;
+
+  init_lattice_fft(&h->fft);
+  soa_alloc(&h->buffer);
+  h->kernel          = (double *) malloc(volume * sizeof(double));
+  h->kernel_sqrt_inv = (double *) malloc(volume * sizeof(double));
+
+  for(ipt=0;ipt<volume;ipt++) {
+
+    // Coordinates t,x,y,z of ipt = x*Y*Z*T + y*Z*T + z*T + t (see "scalar.cpp"):
+    n[0] = ipt%T;
+    n[3] = (ipt/T)%Z;
+    n[2] = (ipt/(T*Z))%Y;
+    n[1] = ipt/(T*Z*Y);
+
+    p2 = 0.;
+    for(mu=0;mu<4;mu++) {
+      p2 += 4*sin(PI*n[mu]/length[mu])*sin(PI*n[mu]/length[mu]);
+    }
+    K = (hmc_fourier_mass2 + 16)/(hmc_fourier_mass2 + p2);
+
+    h->kernel[ipt]          = K/volume;
+    h->kernel_sqrt_inv[ipt] = 1/(sqrt(K)*volume);
+  }
+}
+
+static void free_fourier(hmc_state *h) {
+
+  free_lattice_fft(&h->fft);
+  soa_free(&h->buffer);
+  free(h->kernel);
+  free(h->kernel_sqrt_inv);
+}
+
+// p_field -> B(c F(p_field)) with the forward (F) and backward (B) FFT and c[p] per momentum:
+static void apply_kernel(hmc_state *h, soa_field *p_field, double const *c) {
+
+  int ipt;
+
+  lattice_fft_apply(&h->fft, p_field, -1);
+
+#pragma omp parallel for
+  for(ipt=0;ipt<volume;ipt++) {
+    p_field->re[ipt] *= c[ipt];
+    p_field->im[ipt] *= c[ipt];
+  }
+
+  lattice_fft_apply(&h->fft, p_field, 1);
+}
+
+// Kinetic term sum_p K_p |mom_p|^2/2 (sum_x |mom_x|^2/2 without Fourier acceleration):
+static double kinetic_energy(hmc_state *h) {
+
+  double kinetic[soa_reduction_blocks], sum = 0.;
+  int b, ipt;
+
+  if(hmc_fourier != 1) {
+    return soa_norm2(&h->mom)/2;
+  }
+
+  memcpy(h->buffer.re, h->mom.re, volume*sizeof(double));
+  memcpy(h->buffer.im, h->mom.im, volume*sizeof(double));
+  lattice_fft_apply(&h->fft, &h->buffer, -1);
+
+  // Fixed blocks as in soa_norm2() (see "soa_field.h"), independent of the number of threads:
+#pragma omp parallel for schedule(static) private(ipt)
+  for(b=0;b<soa_reduction_blocks;b++) {
+    kinetic[b] = 0.;
+    for(ipt=(long) volume*b/soa_reduction_blocks;ipt<(long) volume*(b+1)/soa_reduction_blocks;ipt++) {
+      kinetic[b] += h->kernel[ipt]*(h->buffer.re[ipt]*h->buffer.re[ipt] +
+				    h->buffer.im[ipt]*h->buffer.im[ipt]);
+    }
+  }
+
+  for(b=0;b<soa_reduction_blocks;b++) {
+    sum += kinetic[b];
+  }
+  return sum/2;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   Gaussian momenta (Box-Muller transformation of the two uniform random numbers of every  //
+//     lattice point), with the covariance 1/K_p for Fourier acceleration (see (I.)):        //
+//                                                                                           //
+//###########################################################################################//
+
+static void draw_momenta(hmc_state *h, long long step) {
+
+  soa_field *p_mom = &h->mom;
+  double *u = h->u;
+  double r;
+  int ipt;
+
+  rng_uniform_bulk(step, rng_hmc, NULL, 0, volume, u);
+
+#pragma omp parallel for private(r)
+  for(ipt=0;ipt<volume;ipt++) {
+    r = sqrt(-2*log(1 - u[2*ipt]));
+    p_mom->re[ipt] = r*cos(2*PI*u[2*ipt+1]);
+    p_mom->im[ipt] = r*sin(2*PI*u[2*ipt+1]);
+  }
+
+  if(hmc_fourier == 1) {
+    apply_kernel(h, p_mom, h->kernel_sqrt_inv);
+  }
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Molecular dynamics: integrate() makes n steps of the length tau/n on the time scale     //
+//   "level". The momenta are updated with the force of that level (kick()), the field by    //
+//   the next finer level (drift(), level 0 updates the field itself). The half steps of the //
+//              momenta at the end of one step and the start of the next are merged:         //
+//                                                                                           //
+//###########################################################################################//
+
+static void integrate(hmc_state *h, int level, double tau, int n);
+
+static void kick(hmc_state *h, int level, double eps) {
+
+  int terms = soa_force_all;
+
+  if(h->n_levels == 2) {
+    terms = (level == 1 ? soa_force_hopping : soa_force_potential);
+  }
+  soa_update_momenta(&h->phi, &h->mom, eps, terms);
+}
+
+static void drift(hmc_state *h, int level, double eps) {
+
+  if(level == 0 && hmc_fourier == 1) {
+    memcpy(h->buffer.re, h->mom.re, volume*sizeof(double));
+    memcpy(h->buffer.im, h->mom.im, volume*sizeof(double));
+    apply_kernel(h, &h->buffer, h->kernel);
+    soa_axpy(eps, &h->buffer, &h->phi);
+  }
+  else if(level == 0) {
+    soa_axpy(eps, &h->mom, &h->phi);
+  }
+  else {
+    integrate(h, level-1, eps, hmc_n_inner);
+  }
+}
+
+static void integrate(hmc_state *h, int level, double tau, int n) {
+
+  double eps = tau/n;
+  int i;
+
+  if(hmc_integrator == hmc_leapfrog) {
+    kick(h, level, eps/2);
+    for(i=0;i<n;i++) {
+      drift(h, level, eps);
+      kick(h, level, (i < n-1 ? eps : eps/2));
+    }
+  }
+  else {
+    kick(h, level, omelyan_lambda*eps);
+    for(i=0;i<n;i++) {
+      drift(h, level, eps/2);
+      kick(h, level, (1 - 2*omelyan_lambda)*eps);
+      drift(h, level, eps/2);
+      kick(h, level, (i < n-1 ? 2 : 1)*omelyan_lambda*eps);
+    }
+  }
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//   n_field trajectories with the buffers of init_hmc(). The action is evaluated from       //
+//   scratch at the end of every trajectory with the kernel of eval_action_nogauge() (see    //
+//   "action.cpp"), so \Delta H contains no accumulated rounding errors. Its sums are added  //
+//   in a fixed order (see soa_reduction_blocks in "soa_field.h"), so the accept/reject      //
+//   decisions do not depend on the number of threads. A rejected trajectory restarts from   //
+//                           the field before the trajectory:                                //
+//                                                                                           //
+//###########################################################################################//
+
+int init_hmc(hmc_state *h) {
+
+  soa_alloc(&h->phi);
+  soa_alloc(&h->mom);
+  h->u = (double *) malloc(2*volume * sizeof(double));
+  h->n_levels = (hmc_n_inner > 1 ? 2 : 1);
+  if(hmc_fourier == 1) {
+    init_fourier(h);
+  }
+  return 0;
+}
+
+void free_hmc(hmc_state *h) {
+
+  soa_free(&h->phi);
+  soa_free(&h->mom);
+  free(h->u);
+  if(hmc_fourier == 1) {
+    free_fourier(h);
+  }
+}
+
+double hmc(hmc_state *h, scalar_field *p_phi, int n_field, FILE *faction) {
+
+  scalar_field phi = *p_phi;
+  double action, action_new, kinetic, deltaH, u[2];
+  double sum_deltaH = 0., sum_exp_deltaH = 0.;
+  int i, n_acc = 0;
+  double time0 = omp_get_wtime();
+
+  soa_from_field(&h->phi, phi);
+  action = soa_eval_action(&h->phi);
+
+  for(i=0;i<n_field;i++) {
+
+    draw_momenta(h, sweep_count + i);
+    kinetic = kinetic_energy(h);
+
+    integrate(h, h->n_levels-1, hmc_tau, hmc_n_steps);
+
+    action_new = soa_eval_action(&h->phi);
+    deltaH = action_new + kinetic_energy(h) - action - kinetic;
+    sum_deltaH     += deltaH;
+    sum_exp_deltaH += exp(-deltaH);
+
+    rng_uniform(sweep_count + i, rng_hit_purpose(rng_hmc,1), 0, u);
+
+    if(exp(-deltaH) > u[0]) {
+      soa_to_field(phi, &h->phi);
+      action = action_new;
+      n_acc++;
+    }
+    else {
+      soa_from_field(&h->phi, phi);
+    }
+  }
+  sweep_count += n_field;
+
+  double time1 = omp_get_wtime();
+
+  // The running observables of the local updates (see "metropolis.h") are measured again:
+  eval_observables(phi, &observables);
+  observables_valid = 1;
+
+  printf("=====================================================\n");
+  printf("Trajectories = %d, action = %f \n", n_field, action);
+  if(faction != NULL) {
+    fprintf(faction, "%e\n",action);
+  }
+  printf("<|phi|^2> = %f, |<phi>| = %f, hopping = %f \n", observables.phi2/volume,
+	 sqrt(observables.magnetisation.re*observables.magnetisation.re +
+	      observables.magnetisation.im*observables.magnetisation.im)/volume,
+	 observables.hopping/volume);
+  printf("acceptance = %f, <dH> = %f, <exp(-dH)> = %f \n", (double) n_acc/n_field,
+	 sum_deltaH/n_field, sum_exp_deltaH/n_field);
+  printf("trajectories per second = %f \n", n_field/(time1-time0));
+
+  return (double) n_acc/n_field;
+}
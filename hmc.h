@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "types.h"
+#include "soa_field.h"
+#include "fft.h"
+
+// Integrators of the molecular dynamics of the Hybrid Monte Carlo algorithm (see "hmc.cpp"),
+// chosen by the parameter hmc_integrator (see "parameters.h"):
+enum hmc_integrator_type {
+  hmc_leapfrog = 0,
+  hmc_omelyan  = 1   // second order minimum norm integrator with two force steps per step
+};
+
+// Buffers of the trajectories, allocated once by init_hmc() for all calls of hmc():
+struct hmc_state {
+  soa_field phi;   // field during the trajectory
+  soa_field mom;   // conjugate momenta
+  double *u;       // two uniform random numbers per lattice point for the momenta
+  int n_levels;    // 1: one time scale, 2: hopping and potential term on two time scales
+
+  // Fourier acceleration (hmc_fourier = 1): the FFT, K_p/volume and 1/(sqrt(K_p)*volume) at
+  // the lattice point ipt of the momentum p and a buffer of the size of the field
+  lattice_fft fft;
+  double *kernel, *kernel_sqrt_inv;
+  soa_field buffer;
+};
+
+int init_hmc(hmc_state *h);
+void free_hmc(hmc_state *h);
+double hmc(hmc_state *h, scalar_field *p_phi, int n_field, FILE *faction);
@@ -11,210 +11,650 @@
 #include "action.h"
 #include "parameters.h"
 #include "scalar.h"
+#include "geometry.h"
 #include "types.h"
 #include "generator_singleton.h"
+#include "rng.h"
+#include "cluster.h"
 
 
 
-// If the function "metropolis()" (see (II.)) is applied, then the metropolis algorithm is
+// If the function "metropolis()" (see (IV.)) is applied, then the metropolis algorithm is
 // calculated combined for odd and even t (depending on the argument "core" in the called
-// function "metropolis_core()").
+// function "metropolis_core()") if update_mode == 0, or by means of checkerboard sweeps over
+// the whole lattice ("metropolis_sweep()") if update_mode == 1 (see "parameters.h").
+
+// Number of checkerboard sweeps since the start of the chain. It is the step of the random
+// numbers of a sweep (see "rng.h"):
+long long sweep_count = 0;
+
+// Running action, |phi|^2, hopping term and magnetisation of the field updated by metropolis()
+// (see "action.h"). They are measured once (observables_valid == 0) and then only changed by
+// the accepted updates:
+chain_observables observables;
+int observables_valid = 0;
+
+// Number of calls of metropolis(), every n_action_check-th measures the observables again:
+long long n_metropolis_calls = 0;
+
+// State of one thread of the team started by metropolis() (see (IV.)). It is set up once and
+// kept for all steps of the run:
+struct metropolis_worker {
+  int pid, nthreads;
+
+  // update_mode 0: random lattice points of the blocks of the thread, sites[c][0,...,n_sites[c])
+  // are its points of colour c (see block_sites in "geometry.h")
+  int *sites[2];
+  int n_sites[2];
+  std::mt19937 *generator;   // GeneratorSingleton::get() of the thread
+  std::uniform_int_distribution<int> site_distribution[2];
+  std::uniform_real_distribution<double> ZeroOne_distribution;
+
+  // update_mode 1: the sites [k_begin, k_end) of both parities
+  long k_begin, k_end;
+
+  // Random numbers of the proposals and accept/reject decisions (see update_site()) and of
+  // the overrelaxation decisions of both parities (update_mode 1, see overrelax_sweep())
+  double *u_proposal, *u_accept, *u_overrelax;
+
+  // Changes of the observables by the accepted updates of the thread
+  chain_observables *delta;
+
+  // Number of site visits and of accepted updates per hit n_acc_hit[0,...,n_hit)
+  long n_visit;
+  long *n_acc_hit;
+
+  // Number of overrelaxation updates and of accepted ones (see (III.))
+  long n_overrelax_site, n_overrelax_acc;
+};
+
+// Add the change of an accepted update phi_old -> phi_new at a lattice point with neighbour
+// sum b (action change deltaS) to the partial sums of the thread:
+static inline void record_update(chain_observables *d, complex phi_old, complex phi_new,
+				 complex b, double deltaS) {
+
+  double rho_old = phi_old.re*phi_old.re + phi_old.im*phi_old.im;
+  double rho_new = phi_new.re*phi_new.re + phi_new.im*phi_new.im;
+
+  d->action           += deltaS;
+  d->phi2             += rho_new - rho_old;
+  d->hopping          += (phi_new.re - phi_old.re)*b.re + (phi_new.im - phi_old.im)*b.im;
+  d->magnetisation.re += phi_new.re - phi_old.re;
+  d->magnetisation.im += phi_new.im - phi_old.im;
+}
+
+// n_hit Metropolis updates of the field point *p_phi_x with neighbour sum b. The neighbours do
+// not change in between, so b is gathered once for all hits. Hit h uses the proposal
+// u_proposal[2*h*stride], u_proposal[2*h*stride+1] and the decision
+// u_accept[2*(h/2)*stride + h%2] (the hits 2*j and 2*j+1 share one draw, see rng_pair_index()
+// in "rng.h"). The new value is written back only once and the number of accepted hits is
+// returned:
+static inline int update_site(metropolis_worker *w, complex *p_phi_x, complex b,
+			      double const *u_proposal, double const *u_accept, long stride) {
+
+  complex phi_x = *p_phi_x, phi_new;
+  double deltaS;
+  int hit, n_acc = 0;
+
+  for(hit=0;hit<n_hit;hit++) {
+
+    phi_new.re = phi_x.re - deltarho + 2*deltarho * u_proposal[2*hit*stride];
+    phi_new.im = phi_x.im - deltarho + 2*deltarho * u_proposal[2*hit*stride+1];
+    deltaS = local_delta_action(phi_x,phi_new,b);
+
+    if(exp(-deltaS) > u_accept[2*(hit/2)*stride + rng_pair_index(hit)]) {
+      record_update(w->delta,phi_x,phi_new,b,deltaS);
+      phi_x = phi_new;
+      w->n_acc_hit[hit]++;
+      n_acc++;
+    }
+  }
+  w->n_visit++;
+
+  if(n_acc > 0) {
+    *p_phi_x = phi_x;
+  }
+  return n_acc;
+}
 
 //###########################################################################################//
 // (I.)                                                                                      //
-//                        METROPOLIS ALGORITHM FOR ALL ODD OR EVEN t:                        //
+//                    METROPOLIS ALGORITHM FOR ALL ODD OR EVEN LATTICE POINTS:               //
 //                                                                                           //
-//   At the beginning of each MC step, the coordinates t,x,y,z of the initial lattice point  //
-//    lattice_point(t,x,y,z) are chosen randomly (if core==0: only odd t, if core==1: only   //
-//  even t). By means of these space-time coordinates, a small change of the field point is  //
-//    calculated via update_field_point(), see "scalar.cpp". The resulting field point is    //
-//    called phi2. From the initial phi and updated phi2, the change in action is computed   //
-//  ("action.cpp") and if exp(-deltaS)>random with 0<=random<=1, the new field point phi2 is //
-//   adopted via copy_field_point() (see "scalar.cpp"). If this condition is not satisfied,  //
-//                              the initial field point is kept.                             //
+//   At the beginning of each MC step, the initial lattice point is chosen randomly from the //
+//   blocks of the thread (if core==0: only odd, if core==1: only even colour, see           //
+//   init_blocks() in "geometry.cpp"). The old field point phi_old and the sum b of its      //
+//   neighbours are read once, the proposal phi_new = phi_old + small change is kept in      //
+//   registers. The change in action follows from phi_old, phi_new and b alone (see          //
+//   local_delta_action() in "action.h") and if exp(-deltaS)>random with 0<=random<=1,       //
+//   phi_new is adopted. This is repeated n_hit times at the same point (see update_site()), //
+//        then the field point is written to phi if at least one hit was accepted.           //
 //                                                                                           //
 //###########################################################################################//
 
-int metropolis_core(scalar_field *p_phi, scalar_field *p_phi2, int core) {
-  
-  scalar_field phi  = *p_phi;  // Initial scalar field point phi
-  scalar_field phi2 = *p_phi2; // Updated field point phi2 after small change
+static int metropolis_core(scalar_field phi, int core, metropolis_worker *w) {
   
   int update = 0;
-  int x,y,z,t;
-  double deltaS, random;
+  int ipt, hit;
+  complex b;
 
-  // Parallel Computing via Open MP:
-#pragma omp parallel private(x, y, z, t, deltaS, random)
-  {
-    int i=0;
-    int nthreads = omp_get_num_threads();  
-    int pid = omp_get_thread_num();
-    
-    
-    auto x_distribution       = std::uniform_int_distribution<int>(0,X-1);
-    auto y_distribution       = std::uniform_int_distribution<int>(0,Y-1);
-    auto z_distribution       = std::uniform_int_distribution<int>(0,Z-1);
-    auto t_distribution       = std::uniform_int_distribution<int>(0,(T/nthreads)-1);
-    auto ZeroOne_distribution = std::uniform_real_distribution<double>(0.0,1.0);
-    
+  int i=0;
+  int pid = w->pid;
+  int colour = (core == 0 ? 1 : 0);
+
+  // Threads without lattice points of this colour (more threads than blocks) are idle:
+  if(w->n_sites[colour] == 0) {
+    return update;
+  }
+  
+  //=========================================================================================//
+  // (I.A)                                                                                   //
+  // This is the for loop over all n_metropolis MC steps (n_metropolis is the number of      //
+  // local updates in a single Metropolis step):                                             //
+  //                                                                                         //
+  //=========================================================================================//
     
+  for(i=0;i<n_metropolis;i++) {
+      
+      
     //=======================================================================================//
-    // (I.A)                                                                                 //
-    // This is the for loop over all n_metropolis MC steps (n_metropolis is the number of    //
-    // local updates in a single Metropolis step):                                           //
+    // (I.B)                                                                                 //
+    // The ith lattice point is chosen randomly among the points of the thread with odd      //
+    // (core == 0) or even (core == 1) colour. Points of the same colour of different        //
+    // threads are never neighbours, so all threads can update at the same time:             //
     //                                                                                       //
     //=======================================================================================//
-    
-    for(i=0;i<n_metropolis;i++) {
-      
-      
-      //=====================================================================================//
-      // (I.B)                                                                               //
-      // Spatial coordinates of the ith lattice point are created randomly for the           //
-      // ith update:                                                                         //
-      //                                                                                     //
-      //=====================================================================================//
 
-      // get() is the thread number dependend mersenne twister defined in the class
-      // "GeneratorSingleton" in "generator_singleton.h":
-      x = x_distribution(GeneratorSingleton::get());
-      y = y_distribution(GeneratorSingleton::get());
-      z = z_distribution(GeneratorSingleton::get());
+    // The generator of the worker is the thread number dependend mersenne twister defined in
+    // the class "GeneratorSingleton" in "generator_singleton.h":
+    ipt = w->sites[colour][w->site_distribution[colour](*w->generator)];
       
+    //=======================================================================================//
+    // (I.E)                                                                                 //
+    // The sum of the neighbours and the random numbers of all n_hit hits: the change of the //
+    // real and imaginary part (uniformly distr. in [-deltarho,deltarho)) and a probability  //
+    // 0 <= P <= 1, in this order for every hit:                                             //
+    //                                                                                       //
+    //=======================================================================================//
+
+    b = neighbour_sum(phi,ipt);
+    for(hit=0;hit<n_hit;hit++) {
+      w->u_proposal[2*hit]   = w->ZeroOne_distribution(*w->generator);
+      w->u_proposal[2*hit+1] = w->ZeroOne_distribution(*w->generator);
+      w->u_accept[hit]       = w->ZeroOne_distribution(*w->generator);
+    }
       
-      //=====================================================================================//
-      // (I.C)                                                                               //
-      // Odd temporal coordinate of the lattice point is created randomly for the ith update://
-      //                                                                                     //
-      //=====================================================================================//
+    //=======================================================================================//
+    // (I.F)                                                                                 //
+    // For every hit, the change in action \Delta S_E from the current field point phi_old   //
+    // to the proposal phi_new is calculated via local_delta_action() (see action.h) and     //
+    // phi_new is accepted if exp(-\Delta S_E) > P (which includes the case \Delta S_E <=0). //
+    // Otherwise the old field point is kept ("reject"), see update_site():                  //
+    //                                                                                       //
+    //=======================================================================================//
 
-      if(core == 0) {
-	do{
-	  t = t_distribution(GeneratorSingleton::get()) + pid*T/nthreads;
-	}
-	while(t%2==0);
-      }
+    if(update_site(w,&phi[ipt],b,w->u_proposal,w->u_accept,1) > 0) {
+	
+      if(pid==0 && i==0) {               // Only if we have a new scalar field point
+	update = 1;                      // (pid==0 && i==0 means new master thread),
+      }                                  // "update" is set to 1.
+    }
+  }
+  return update;
+}
 
-      //=====================================================================================//
-      // (I.D)                                                                               //
-      //Even temporal coordinate of the lattice point is created randomly for the ith update://
-      //                                                                                     //
-      //=====================================================================================//
-      
-      if(core == 1) {
-	do{
-	  t = t_distribution(GeneratorSingleton::get()) + pid*T/nthreads;
-	}
-	while(t%2==1);
-      }
-      
-      //=====================================================================================//
-      // (I.E)                                                                               //
-      // The function update_field_point() (see scalar.cpp) effects a small change of the    //
-      // initial field point depending on the coordinates chosen randomly above. The new     //
-      // scalar field point is p_aux = phi2:                                                 //
-      //=====================================================================================//
 
-      update_field_point(&phi2,t,x,y,z);
-      
-      //=====================================================================================//
-      // (I.F)                                                                               //
-      // From the initial field point phi_old=phi and the updated field point phi_new=phi2,  //
-      // the change in action \Delta S_E is calculated via delta_action_nogauge()            //
-      // (see action.cpp):                                                                   //
-      //                                                                                     //
-      //=====================================================================================//
-      
-      deltaS = delta_action_nogauge(phi,phi2,x,y,z,t);
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//                   METROPOLIS ALGORITHM AS A DETERMINISTIC CHECKERBOARD SWEEP:             //
+//                                                                                           //
+//  In contrast to (I.), every lattice point is updated exactly once per sweep. The lattice  //
+//  is split into even and odd sites (parity of t+x+y+z). Since all nearest neighbours of an //
+//   even site are odd (and vice versa), all sites of one parity can be updated at the same  //
+//  time. Each parity half is split statically across the threads and traversed in memory    //
+//  order. This is the part of the sweep "step" of one thread of the team (see (IV.)), it    //
+//                  returns the number of accepted updates of the thread.                    //
+//                                                                                           //
+//###########################################################################################//
+
+static long metropolis_sweep(scalar_field phi, long long step, metropolis_worker *w) {
+
+  int ipt,parity,hit;
+  long k;
+  long n = w->k_end - w->k_begin;
+  long acc_thread = 0;
+
+  for(parity=0;parity<2;parity++) {
+
+    //=======================================================================================//
+    // (II.A)                                                                                //
+    // The index k runs over the sites [k_begin,k_end) of the given parity in the order in   //
+    // which they are stored (see parity_sites in "geometry.h"). The random numbers of all   //
+    // sites and hits of the thread are generated at once (the proposal of hit h of the      //
+    // site k at 2*(h*n + k-k_begin), its decision at 2*((h/2)*n + k-k_begin) + h%2). They   //
+    // are keyed by (seed, step, site, purpose) (see "rng.h"), so the sweep does not depend  //
+    // on the number of threads:                                                             //
+    //                                                                                       //
+    //=======================================================================================//
+
+    for(hit=0;hit<n_hit;hit++) {
+      rng_uniform_bulk(step, rng_hit_purpose(rng_proposal,hit), parity_sites[parity] + w->k_begin,
+		       0, n, w->u_proposal + 2*n*hit);
+    }
+    for(hit=0;hit<n_hit;hit+=2) {
+      rng_uniform_bulk(step, rng_hit_purpose(rng_accept,hit), parity_sites[parity] + w->k_begin,
+		       0, n, w->u_accept + n*hit);
+    }
+
+    for(k=w->k_begin;k<w->k_end;k++) {
+
+      ipt = parity_sites[parity][k];
 
       //=====================================================================================//
-      // (I.G)                                                                               //
-      //   Generate a probability randomly with 0 <= P <= 1 (real numbers uniformly distr.   //
-      //      between 0 and 1) and accept the updated field point phi2 with probability      //
-      //            exp(-\Delta S_E) > P (which includes the case \Delta S_E <=0):           //
+      // (II.B)                                                                              //
+      // Same local update as in (I.E) - (I.G):                                              //
       //                                                                                     //
       //=====================================================================================//
 
-      random = ZeroOne_distribution(GeneratorSingleton::get());
-      
+      acc_thread += update_site(w,&phi[ipt],neighbour_sum(phi,ipt),
+				w->u_proposal + 2*(k-w->k_begin),w->u_accept + 2*(k-w->k_begin),n);
+    }
+
+    // Phase barrier: all sites of one parity are updated before the next parity starts
+#pragma omp barrier
+  }
+
+  return acc_thread;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//                                 OVERRELAXATION SWEEP:                                     //
+//                                                                                           //
+//  With the neighbour sum b, the part of the action which depends on the field point phi is //
+//          (1-2*LAMBDA)*|phi|^2 - 2*KAPPA*Re(phi^* b) + LAMBDA*|phi|^4 (+ const.).          //
+//   If 1-2*LAMBDA > 0, the point reflection phi' = 2*phi_0 - phi about the minimum          //
+//  phi_0 = KAPPA*b/(1-2*LAMBDA) of the Gaussian part does not change the Gaussian part, so  //
+//  only the quartic term is corrected by an accept/reject step with exp(-\Delta S_E).       //
+//  Else phi is reflected about the line along b, which keeps |phi| and Re(phi^* b) and      //
+//  thus the action. Both reflections are their own inverse, so detailed balance holds.      //
+//  They change the field by large steps at (almost) no cost in action and are interleaved   //
+//  with the Metropolis updates (n_overrelax sweeps per Metropolis step, see                 //
+//  "parameters.h"). The checkerboard order and the split across the threads are the same    //
+//  as in (II.). The accept/reject decisions of the sweep "sweep" of the step "step" are     //
+//  the number sweep%2 of the draw rng_hit_purpose(rng_overrelax,sweep - sweep%2) for        //
+//  update_mode 1 (see rng_pair_index() in "rng.h") and drawn from the mersenne twister of   //
+//                           the thread for update_mode 0:                                   //
+//                                                                                           //
+//###########################################################################################//
+
+static void overrelax_sweep(scalar_field phi, long long step, int sweep, metropolis_worker *w) {
+
+  int ipt,parity;
+  long k;
+  long n = w->k_end - w->k_begin;
+  double deltaS, random, c, bb;
+  double a = 1 - 2*LAMBDA;
+  complex phi_old, phi_new, b;
+
+  for(parity=0;parity<2;parity++) {
+
+    // The sweeps 2*j and 2*j+1 use the two numbers of one draw (see rng_pair_index()):
+    if(update_mode == 1 && rng_pair_index(sweep) == 0) {
+      rng_uniform_bulk(step, rng_hit_purpose(rng_overrelax,sweep),
+		       parity_sites[parity] + w->k_begin, 0, n, w->u_overrelax + 2*n*parity);
+    }
+
+    for(k=w->k_begin;k<w->k_end;k++) {
+
+      ipt = parity_sites[parity][k];
+      phi_old = phi[ipt];
+      b = neighbour_sum(phi,ipt);
+
+      if(a > 0) {
+	phi_new.re = 2*KAPPA*b.re/a - phi_old.re;
+	phi_new.im = 2*KAPPA*b.im/a - phi_old.im;
+      }
+      else {
+	bb = b.re*b.re + b.im*b.im;
+	if(bb == 0) continue;
+	c = 2*(phi_old.re*b.re + phi_old.im*b.im)/bb;
+	phi_new.re = c*b.re - phi_old.re;
+	phi_new.im = c*b.im - phi_old.im;
+      }
+
+      deltaS = local_delta_action(phi_old,phi_new,b);
+      random = (update_mode == 1
+		? w->u_overrelax[2*(n*parity + k-w->k_begin) + rng_pair_index(sweep)]
+		: w->ZeroOne_distribution(*w->generator));
+
       if(exp(-deltaS) > random) {
-	
-	copy_field_point(&phi,&phi2,t,x,y,z);  // The function copy_field_point() (see
-	                                  // scalar.cpp) replaces the field point "phi" with
-	                                  // "phi2" which means that the updated field point
-	                                  // is accepted.
-	
-	if(pid==0 && i==0) {               // Only if we have a new scalar field point
-	  update = 1;                      // (pid==0 && i==0 means new master thread),
-	}                                  // "update" is set to 1.
+	record_update(w->delta,phi_old,phi_new,b,deltaS);
+	phi[ipt] = phi_new;
+	w->n_overrelax_acc++;
       }
+      w->n_overrelax_site++;
+    }
 
-      //=====================================================================================//
-      // (I.H)                                                                               //
-      // If the condition exp(-deltaS) > random is not satisfied, then the old field point   //
-      // "phi" is kept ("reject"):                                                           //
-      //                                                                                     //
-      //=====================================================================================//
-      
-      copy_field_point(&phi2,&phi,t,x,y,z);
+    // Phase barrier: all sites of one parity are updated before the next parity starts
+#pragma omp barrier
+  }
+}
+
+
+
+// Acceptance of every hit of the multi-hit update (see update_site()), i.e. the accepted hits
+// number h of all threads per site visit:
+static void print_hit_acceptance(long const *n_acc_hit, long const *n_visit_thread, int nthreads) {
+
+  long n_visit = 0, n_acc;
+  int pid, hit;
+
+  if(n_hit < 2) return;
+
+  for(pid=0;pid<nthreads;pid++) {
+    n_visit += n_visit_thread[pid];
+  }
+  for(hit=0;hit<n_hit;hit++) {
+    n_acc = 0;
+    for(pid=0;pid<nthreads;pid++) {
+      n_acc += n_acc_hit[(long) pid*n_hit + hit];
     }
+    printf("hit %d: acceptance = %f \n", hit, (double) n_acc/n_visit);
   }
-  return update;
 }
 
 
 
 //###########################################################################################//
-// (II.)                                                                                     //
+// (IV.)                                                                                     //
 //                               COMPLETE METROPOLIS ALGORITHM:                              //
 //                                                                                           //
 //    This function unifies the even and the odd metropolis core provided by the function    //
-//                             "metropolis_core()" given in (I.).                            //
+//  "metropolis_core()" given in (I.) (update_mode 0) or performs n_field checkerboard       //
+//                sweeps "metropolis_sweep()" given in (II.) (update_mode 1).                //
+//                                                                                           //
+//   A single team of threads is started for all n_field steps. Every thread keeps its part  //
+//   of the lattice, its random number generator and its distributions (metropolis_worker)   //
+//   for the whole run, the threads only meet at the barriers between the two halves of a    //
+//                                   step (see (I.) and (II.)).                              //
 //                                                                                           //
 //###########################################################################################//
 
 double metropolis(scalar_field *p_phi, int n_field, FILE *faction) {
 
   int i=0;
-  int core_odd, core_even;
   int n_acc = 0;
   double acc=0;
   scalar_field phi = *p_phi;
-  scalar_field phi2;
   double action;
+  int nthreads = omp_get_max_threads();
+  long *n_acc_thread  = (long *) calloc(nthreads, sizeof(long));
+  long *n_site_thread = (long *) calloc(nthreads, sizeof(long));
+  long *n_acc_sweep   = (long *) calloc(n_field, sizeof(long));
+  long *n_visit_thread = (long *) calloc(nthreads, sizeof(long));
+  long *n_acc_hit      = (long *) calloc((long) nthreads*n_hit, sizeof(long));
+  long n_overrelax_site = 0, n_overrelax_acc = 0;
+  cluster_workspace cw;
+  double time0 = omp_get_wtime();
   
 
-  // In "parameters.h": Use any non-zero integer as a seed
-  
- 
-  initialize_field(&phi2);
-  copy_field(&phi2,&phi);   
+  // The observables are only measured in full at the first call (see observables_valid):
+  chain_observables *delta_thread = (chain_observables *) calloc(nthreads, sizeof(chain_observables));
+  if(observables_valid == 0) {
+    eval_observables(phi, &observables);
+    observables_valid = 1;
+  }
+
+  if(cluster_mode != cluster_off) {
+    init_cluster_workspace(&cw);
+  }
+
+#pragma omp parallel
+  {
+    metropolis_worker w;
+    int step, core_odd, core_even, sweep;
+    long acc_step, n_u;
+
+    //=======================================================================================//
+    //                                                                                       //
+    // The state of the thread, which is kept for all steps:                                 //
+    //                                                                                       //
+    //=======================================================================================//
+
+    w.pid      = omp_get_thread_num();
+    w.nthreads = omp_get_num_threads();
+    w.delta    = &delta_thread[w.pid];
+    w.generator = &GeneratorSingleton::get();
+    w.ZeroOne_distribution = std::uniform_real_distribution<double>(0.0,1.0);
+
+    // The blocks of the random-site updates are only rebuilt if the number of threads changes
+    // (see init_blocks() in "geometry.cpp"):
+    if(update_mode == 0) {
+#pragma omp single
+      if(block_threads != w.nthreads) {
+	init_blocks(w.nthreads);
+      }
+
+      for(int c=0;c<2;c++) {
+	w.sites[c]   = block_sites[c] + block_offset[c][w.pid];
+	w.n_sites[c] = block_offset[c][w.pid+1] - block_offset[c][w.pid];
+	w.site_distribution[c] = std::uniform_int_distribution<int>(0,w.n_sites[c]-1);
+      }
+    }
+
+    // Every thread updates the same contiguous part [k_begin,k_end) of both parities:
+    w.k_begin = (volume/2) * (long) w.pid / w.nthreads;
+    w.k_end   = (volume/2) * (long) (w.pid+1) / w.nthreads;
+
+    // Random numbers of all hits of all sites of one parity (update_mode 1) or of all hits of
+    // one site (update_mode 0):
+    n_u = 2 * (long) n_hit * (update_mode == 1 ? w.k_end-w.k_begin : 1);
+    w.u_proposal = (double *) malloc(n_u * sizeof(double));
+    w.u_accept   = (double *) malloc(n_u * sizeof(double));
+    w.u_overrelax = (double *) malloc(4 * (w.k_end-w.k_begin) * sizeof(double));
+    w.n_visit    = 0;
+    w.n_overrelax_site = 0;
+    w.n_overrelax_acc  = 0;
+    w.n_acc_hit  = n_acc_hit + (long) w.pid*n_hit;
+
+    //=======================================================================================//
+    //                                                                                       //
+    // Checkerboard sweeps: the random numbers of the sweep step are keyed by                //
+    // sweep_count + step (see "rng.h"). Every sweep is followed by n_overrelax              //
+    // overrelaxation sweeps (see (III.)) and n_cluster cluster updates of the master        //
+    // thread (see "cluster.cpp"):                                                           //
+    //                                                                                       //
+    //=======================================================================================//
+
+    if(update_mode == 1) {
+      for(step=0;step<n_field;step++) {
+	acc_step = metropolis_sweep(phi,sweep_count + step,&w);
+	n_acc_thread[w.pid]  += acc_step;
+	n_site_thread[w.pid] += 2*(w.k_end-w.k_begin)*n_hit;
+#pragma omp atomic
+	n_acc_sweep[step] += acc_step;
+
+	for(sweep=0;sweep<n_overrelax;sweep++) {
+	  overrelax_sweep(phi,sweep_count + step,sweep,&w);
+	}
+
+	if(cluster_mode != cluster_off) {
+#pragma omp master
+	  for(int c=0;c<n_cluster;c++) {
+	    cluster_update(phi,sweep_count + step,c,&cw,w.delta);
+	  }
+#pragma omp barrier
+	}
+      }
+    }
+
+    //=======================================================================================//
+    //                                                                                       //
+    // Combine the metropolis algorithm for odd t and even t. Only the master thread counts  //
+    // the updates (see (I.)); all threads read n_acc after the barrier of the even core,    //
+    // before the master changes it again after the next even core. The overrelaxation       //
+    // sweeps (see (III.)) and the cluster updates (see "cluster.cpp") follow the even       //
+    // core:                                                                                 //
+    //                                                                                       //
+    //=======================================================================================//
+
+    else {
+      while(n_acc<n_field) {
+
+	core_odd  = metropolis_core(phi,0,&w);
+#pragma omp barrier
+	core_even = metropolis_core(phi,1,&w);
+
+	if(w.pid == 0) {
+	  i += 2;
+	  n_acc+= (core_odd + core_even);
+	}
+#pragma omp barrier
+
+	for(sweep=0;sweep<n_overrelax;sweep++) {
+	  overrelax_sweep(phi,0,sweep,&w);
+	}
+
+	if(cluster_mode != cluster_off) {
+#pragma omp master
+	  for(int c=0;c<n_cluster;c++) {
+	    cluster_update(phi,0,c,&cw,w.delta);
+	  }
+#pragma omp barrier
+	}
+      }
+    }
+
+    n_visit_thread[w.pid] = w.n_visit;
+#pragma omp atomic
+    n_overrelax_site += w.n_overrelax_site;
+#pragma omp atomic
+    n_overrelax_acc += w.n_overrelax_acc;
+    free(w.u_proposal);
+    free(w.u_accept);
+    free(w.u_overrelax);
+  }
+
+  double time1 = omp_get_wtime();
 
   //=========================================================================================//
   //                                                                                         //
-  // Combine the metropolis algorithm for odd t and even t:                                  //
+  // Add the partial sums of the threads (in the order of the threads) to the running        //
+  // observables. Every n_action_check calls they are measured again to remove the rounding  //
+  // errors accumulated by the updates:                                                      //
   //                                                                                         //
   //=========================================================================================//
-  
-  while(n_acc<n_field) {
 
-    core_odd  = metropolis_core(p_phi,&phi2,0);
-    core_even = metropolis_core(p_phi,&phi2,1);
+  for(int pid=0;pid<nthreads;pid++) {
+    observables.action           += delta_thread[pid].action;
+    observables.phi2             += delta_thread[pid].phi2;
+    observables.hopping          += delta_thread[pid].hopping;
+    observables.magnetisation.re += delta_thread[pid].magnetisation.re;
+    observables.magnetisation.im += delta_thread[pid].magnetisation.im;
+  }
+  free(delta_thread);
+
+  n_metropolis_calls++;
+  if(n_action_check > 0 && n_metropolis_calls%n_action_check == 0) {
+    action = observables.action;
+    eval_observables(phi, &observables);
+    printf("running action %f, measured action %f (drift %e) \n", action, observables.action,
+	   action - observables.action);
+  }
+  action = observables.action;
+
+  //=========================================================================================//
+  //                                                                                         //
+  // Checkerboard sweeps: Print the acceptance per sweep (mean, min, max), per thread and    //
+  // the number of sweeps per second:                                                        //
+  //                                                                                         //
+  //=========================================================================================//
+
+  if(update_mode == 1) {
+
+    long n_acc_tot = 0;
+    double acc_step, acc_min = 1., acc_max = 0.;
 
-    i += 2;
-    n_acc+= (core_odd + core_even);
+    for(i=0;i<n_field;i++) {
+      n_acc_tot += n_acc_sweep[i];
+
+      acc_step = (double) n_acc_sweep[i]/((double) volume*n_hit);
+      if(acc_step < acc_min) acc_min = acc_step;
+      if(acc_step > acc_max) acc_max = acc_step;
+    }
+    sweep_count += n_field;
 
+    acc = (double) n_acc_tot/((double) n_field*(volume)*n_hit);
+
+    printf("=====================================================\n");
+    printf("Sweeps = %d, action = %f \n", n_field, action);
+    if(faction != NULL) {
+      fprintf(faction, "%e\n",action);
+    }
+    printf("<|phi|^2> = %f, |<phi>| = %f, hopping = %f \n", observables.phi2/volume,
+	   sqrt(observables.magnetisation.re*observables.magnetisation.re +
+		observables.magnetisation.im*observables.magnetisation.im)/volume,
+	   observables.hopping/volume);
+    printf("acceptance = %f (per sweep: min %f, max %f) \n", acc, acc_min, acc_max);
+    for(int pid=0;pid<nthreads;pid++) {
+      if(n_site_thread[pid] > 0) {
+	printf("thread %d: acceptance = %f \n", pid, (double) n_acc_thread[pid]/n_site_thread[pid]);
+      }
+    }
+    print_hit_acceptance(n_acc_hit, n_visit_thread, nthreads);
+    if(n_overrelax_site > 0) {
+      printf("overrelaxation: acceptance = %f \n", (double) n_overrelax_acc/n_overrelax_site);
+    }
+    if(cluster_mode != cluster_off) {
+      print_cluster_statistics(&cw);
+      free_cluster_workspace(&cw);
+    }
+    printf("sweeps per second = %f \n", n_field/(time1-time0));
+
+    free(n_acc_thread);
+    free(n_site_thread);
+    free(n_acc_sweep);
+    free(n_visit_thread);
+    free(n_acc_hit);
+    return acc;
   }
-  
-  phi = *p_phi;
-  action = eval_action_nogauge(phi);
+
+  // Acceptance per proposal: accepted hits over all visits of all threads times n_hit (the
+  // accepted steps n_acc only count the first visit of the master thread of every core):
+  long n_visit_tot = 0, n_acc_hit_tot = 0;
+
+  for(int pid=0;pid<nthreads;pid++) {
+    n_visit_tot += n_visit_thread[pid];
+    for(int hit=0;hit<n_hit;hit++) {
+      n_acc_hit_tot += n_acc_hit[(long) pid*n_hit + hit];
+    }
+  }
+
   printf("=====================================================\n");
   printf("Accepted step = %d, action = %f \n",n_acc, action);
-  fprintf(faction, "%e\n",action);
-  acc = (double) n_acc/i;
+  if(faction != NULL) {
+    fprintf(faction, "%e\n",action);
+  }
+  acc = (double) n_acc_hit_tot/((double) n_visit_tot*n_hit);
     
-  printf("acceptance = %f \n", (double) n_acc/i);
+  printf("acceptance = %f \n", acc);
+  print_hit_acceptance(n_acc_hit, n_visit_thread, nthreads);
+  if(n_overrelax_site > 0) {
+    printf("overrelaxation: acceptance = %f \n", (double) n_overrelax_acc/n_overrelax_site);
+  }
+  if(cluster_mode != cluster_off) {
+    print_cluster_statistics(&cw);
+    free_cluster_workspace(&cw);
+  }
   
+  free(n_acc_thread);
+  free(n_site_thread);
+  free(n_acc_sweep);
+  free(n_visit_thread);
+  free(n_acc_hit);
   return acc;
 }
@@ -1 +1,17 @@
+#include "types.h"
+#include "action.h"
+
+extern long long sweep_count; // checkerboard sweeps since the start of the chain
+
+// Running observables of the field updated by metropolis(). Set observables_valid = 0 if the
+// field is changed in another way, then they are measured again at the next call:
+extern chain_observables observables;
+extern int observables_valid;
+
+// Calls of metropolis() since the start of the chain (schedule of n_action_check):
+extern long long n_metropolis_calls;
+
+// n_field Metropolis steps (sweeps for update_mode 1). The action after the last one is
+// appended to faction unless it is NULL (the same holds for hmc(), replica_exchange() and
+// chains_metropolis()):
 double metropolis(scalar_field *p_phi, int n_field, FILE *faction);
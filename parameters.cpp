@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "parameters.h"
+#include "rng.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Default values of all runtime parameters declared in "parameters.h". They are             //
+// overwritten by read_parameters() (see (II.)) from an input file and the command line.     //
+//                                                                                           //
+//*******************************************************************************************//
+
+int T = 8;
+int X = 6;
+int Y = 6;
+int Z = 6;
+int volume = 8*6*6*6;
+
+double LAMBDA, KAPPA;  // see calculate_parameters()
+
+double m2_0     = -4.9;
+double lambda_c = 10.0;
+
+double deltarho = 1;
+int seed        = 0;
+
+int start_random_conf = 0;
+int n_save            = 20;
+int start_random      = 0;
+const char *start_conf = "./start_config/scalar_6_6_6_8_6000.txt";
+int n_term_field      = 1000;
+int n_therm_check     = 0;
+int therm_window      = 10;
+double therm_z        = 2;
+int n_tune            = 0;
+double tune_acceptance = 0.5;
+double tune_acceptance_hmc = 0.8;
+int update_mode       = 0;
+int n_metropolis      = 250*10*4;
+int n_hit             = 1;
+int n_overrelax       = 0;
+int cluster_mode      = 0;
+int n_cluster         = 1;
+double hmc_tau        = 1;
+int hmc_n_steps       = 10;
+int hmc_integrator    = 1;
+int hmc_n_inner       = 1;
+int hmc_fourier       = 0;
+double hmc_fourier_mass2 = 1;
+int n_replica         = 0;
+double replica_dm2_0  = 0.1;
+double replica_dlambda_c = 0;
+int n_replica_swap    = 10;
+int n_chain           = 1;
+int n_action_check    = 0;
+int n_term_save       = 1000;
+int n_autocorr        = 0;
+int autocorr_w_max    = 200;
+double save_tau_factor = 0;
+int field_format      = 0;
+const char *ensemble_file = "";
+const char *checkpoint_file = "checkpoint.dat";
+int n_checkpoint      = 1;
+int resume            = 0;
+const char *path_read = "./field_configs/";
+const char *path_corr = "./corr_analysis/";
+int n_fields          = 5;
+int n_analyse         = 20;
+int n_restrict        = 1;
+int correlator        = 1;
+int n_readers         = 1;
+int n_workers         = 0;
+int queue_depth       = 4;
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Table of all runtime parameters: name (in the input file and on the command line),      //
+//                           type ('i' int, 'd' double, 's' string) and address:             //
+//                                                                                           //
+//###########################################################################################//
+
+struct parameter_entry {
+  const char *name;
+  char type;
+  void *value;
+};
+
+static parameter_entry parameter_table[] = {
+  {"T",                 'i', &T},
+  {"X",                 'i', &X},
+  {"Y",                 'i', &Y},
+  {"Z",                 'i', &Z},
+  {"m2_0",              'd', &m2_0},
+  {"lambda_c",          'd', &lambda_c},
+  {"deltarho",          'd', &deltarho},
+  {"seed",              'i', &seed},
+  {"start_random_conf", 'i', &start_random_conf},
+  {"n_save",            'i', &n_save},
+  {"start_random",      'i', &start_random},
+  {"start_conf",        's', &start_conf},
+  {"n_term_field",      'i', &n_term_field},
+  {"n_therm_check",     'i', &n_therm_check},
+  {"therm_window",      'i', &therm_window},
+  {"therm_z",           'd', &therm_z},
+  {"n_tune",            'i', &n_tune},
+  {"tune_acceptance",   'd', &tune_acceptance},
+  {"tune_acceptance_hmc", 'd', &tune_acceptance_hmc},
+  {"update_mode",       'i', &update_mode},
+  {"n_metropolis",      'i', &n_metropolis},
+  {"n_hit",             'i', &n_hit},
+  {"n_overrelax",       'i', &n_overrelax},
+  {"cluster_mode",      'i', &cluster_mode},
+  {"n_cluster",         'i', &n_cluster},
+  {"hmc_tau",           'd', &hmc_tau},
+  {"hmc_n_steps",       'i', &hmc_n_steps},
+  {"hmc_integrator",    'i', &hmc_integrator},
+  {"hmc_n_inner",       'i', &hmc_n_inner},
+  {"hmc_fourier",       'i', &hmc_fourier},
+  {"hmc_fourier_mass2", 'd', &hmc_fourier_mass2},
+  {"n_replica",         'i', &n_replica},
+  {"replica_dm2_0",     'd', &replica_dm2_0},
+  {"replica_dlambda_c", 'd', &replica_dlambda_c},
+  {"n_replica_swap",    'i', &n_replica_swap},
+  {"n_chain",           'i', &n_chain},
+  {"n_action_check",    'i', &n_action_check},
+  {"n_term_save",       'i', &n_term_save},
+  {"n_autocorr",        'i', &n_autocorr},
+  {"autocorr_w_max",    'i', &autocorr_w_max},
+  {"save_tau_factor",   'd', &save_tau_factor},
+  {"field_format",      'i', &field_format},
+  {"ensemble_file",     's', &ensemble_file},
+  {"checkpoint_file",   's', &checkpoint_file},
+  {"n_checkpoint",      'i', &n_checkpoint},
+  {"resume",            'i', &resume},
+  {"path_read",         's', &path_read},
+  {"path_corr",         's', &path_corr},
+  {"n_fields",          'i', &n_fields},
+  {"n_analyse",         'i', &n_analyse},
+  {"n_restrict",        'i', &n_restrict},
+  {"correlator",        'i', &correlator},
+  {"n_readers",         'i', &n_readers},
+  {"n_workers",         'i', &n_workers},
+  {"queue_depth",       'i', &queue_depth},
+};
+
+static const int n_parameters = sizeof(parameter_table)/sizeof(parameter_table[0]);
+
+static int set_parameter(const char *name, const char *value) {
+
+  int i;
+  char *endptr;
+
+  for(i=0;i<n_parameters;i++) {
+    if(strcmp(parameter_table[i].name, name) != 0) continue;
+
+    switch(parameter_table[i].type) {
+    case 'i':
+      *(int *) parameter_table[i].value = (int) strtol(value, &endptr, 10);
+      break;
+    case 'd':
+      *(double *) parameter_table[i].value = strtod(value, &endptr);
+      break;
+    case 's':
+      *(const char **) parameter_table[i].value = strdup(value);
+      return 0;
+    }
+    if(endptr == value || *endptr != '\0') {
+      printf("Invalid value \"%s\" for parameter %s\n", value, name);
+      exit(1);
+    }
+    return 0;
+  }
+  printf("Unknown parameter %s\n", name);
+  exit(1);
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//    Read the parameters from an input file (lines "name = value", "#" starts a comment)    //
+//     and from the command line ("--name value" or "name=value"), in this order. The        //
+//               input file is given as "-i file" or as the first plain argument:            //
+//                                                                                           //
+//###########################################################################################//
+
+static int read_parameter_file(const char *filename) {
+
+  FILE *file = fopen(filename, "r");
+  char line[512], name[128], value[384];
+  char *comment;
+
+  if(file == NULL) {
+    printf("Failed to open %s\n", filename);
+    exit(1);
+  }
+
+  while(fgets(line, sizeof(line), file)) {
+
+    comment = strchr(line, '#');
+    if(comment != NULL) *comment = '\0';
+
+    if(sscanf(line, " %127[^= \t] = %383s", name, value) == 2) {
+      set_parameter(name, value);
+    }
+  }
+  fclose(file);
+  return 0;
+}
+
+int read_parameters(int argc, char *argv[]) {
+
+  int i;
+  char name[128];
+  const char *equal;
+
+  for(i=1;i<argc;i++) {
+
+    if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      printf("Usage: %s [input file] [-i input file] [--name value] [name=value] [--resume]\n", argv[0]);
+      printf("Parameters and their current values:\n");
+      print_parameters(stdout);
+      exit(0);
+    }
+    else if(strcmp(argv[i], "-i") == 0 && i+1 < argc) {
+      read_parameter_file(argv[++i]);
+    }
+    else if(strcmp(argv[i], "--resume") == 0) {
+      resume = 1;
+    }
+    else if(strncmp(argv[i], "--", 2) == 0 && i+1 < argc) {
+      set_parameter(argv[i]+2, argv[i+1]);
+      i++;
+    }
+    else if((equal = strchr(argv[i], '=')) != NULL && equal-argv[i] < (long) sizeof(name)) {
+      strncpy(name, argv[i], equal-argv[i]);
+      name[equal-argv[i]] = '\0';
+      set_parameter(name, equal+1);
+    }
+    else if(i == 1) {
+      read_parameter_file(argv[i]);
+    }
+    else {
+      printf("Invalid argument %s (see %s --help)\n", argv[i], argv[0]);
+      exit(1);
+    }
+  }
+
+  if(T<1 || X<1 || Y<1 || Z<1) {
+    printf("Invalid lattice size T=%d X=%d Y=%d Z=%d\n", T,X,Y,Z);
+    exit(1);
+  }
+  if(cluster_mode<0 || cluster_mode>2) {
+    printf("Invalid cluster_mode %d\n", cluster_mode);
+    exit(1);
+  }
+  // Every cluster update uses three hit purposes (see "cluster.cpp"):
+  if(n_cluster<1 || 3*n_cluster > rng_max_hit) {
+    printf("Invalid number of cluster updates n_cluster=%d (1 <= n_cluster <= %d)\n", n_cluster,
+	   rng_max_hit/3);
+    exit(1);
+  }
+  if(hmc_n_steps<1 || hmc_n_inner<1) {
+    printf("Invalid number of HMC steps hmc_n_steps=%d hmc_n_inner=%d\n", hmc_n_steps, hmc_n_inner);
+    exit(1);
+  }
+  if(hmc_fourier<0 || hmc_fourier>1 || (hmc_fourier == 1 && hmc_fourier_mass2 <= 0)) {
+    printf("Invalid hmc_fourier=%d (0 or 1, Fourier acceleration needs hmc_fourier_mass2 > 0)\n",
+	   hmc_fourier);
+    exit(1);
+  }
+  if(update_mode<0 || update_mode>2) {
+    printf("Invalid update_mode %d (0, 1 or 2)\n", update_mode);
+    exit(1);
+  }
+  if(update_mode == 2 && (n_hit > 1 || n_overrelax > 0 || cluster_mode != 0)) {
+    printf("The HMC (update_mode 2) has no Metropolis hits, overrelaxation or cluster updates (n_hit 1, n_overrelax 0, cluster_mode 0)\n");
+    exit(1);
+  }
+  // Replicas and batched chains are only updated by checkerboard sweeps:
+  if((n_replica > 1 || n_chain > 1) && update_mode == 0) {
+    printf("Replica exchange and batched chains run checkerboard sweeps, update_mode is set to 1\n");
+    update_mode = 1;
+  }
+  if(n_replica > 1 && (n_replica_swap<1 || resume == 1 || ensemble_file[0] != '\0')) {
+    printf("Replica exchange needs n_replica_swap >= 1 and supports neither resume nor ensemble_file\n");
+    exit(1);
+  }
+  if(n_replica > 1 && (update_mode != 1 || n_overrelax > 0 || cluster_mode != 0)) {
+    printf("Replica exchange only runs checkerboard Metropolis sweeps (update_mode 1, no n_overrelax, no cluster_mode)\n");
+    exit(1);
+  }
+  if(n_chain<1 || (n_chain > 1 && (resume == 1 || n_replica > 1))) {
+    printf("Invalid n_chain=%d (n_chain > 1 supports neither resume nor n_replica > 1)\n", n_chain);
+    exit(1);
+  }
+  if(n_chain > 1 && (update_mode != 1 || n_overrelax > 0 || cluster_mode != 0)) {
+    printf("Batched chains only run checkerboard Metropolis sweeps (update_mode 1, no n_overrelax, no cluster_mode)\n");
+    exit(1);
+  }
+  if(start_random<0 || start_random>3) {
+    printf("Invalid start_random %d\n", start_random);
+    exit(1);
+  }
+  if(n_therm_check<0 || therm_window<2 || therm_z <= 0 ||
+     (n_therm_check > 0 && (n_replica > 1 || n_chain > 1 || (n_tune > 0 && n_therm_check%n_tune != 0)))) {
+    printf("Invalid n_therm_check=%d therm_window=%d therm_z=%f (single chain only, multiple of n_tune)\n",
+	   n_therm_check, therm_window, therm_z);
+    exit(1);
+  }
+  if(n_tune<0 || tune_acceptance <= 0 || tune_acceptance >= 1 || tune_acceptance_hmc <= 0 ||
+     tune_acceptance_hmc >= 1) {
+    printf("Invalid tuning n_tune=%d tune_acceptance=%f tune_acceptance_hmc=%f\n", n_tune,
+	   tune_acceptance, tune_acceptance_hmc);
+    exit(1);
+  }
+  if(n_autocorr > 0 && (n_term_save%n_autocorr != 0 || autocorr_w_max<1 || n_replica > 1 ||
+			n_chain > 1)) {
+    printf("n_autocorr=%d needs n_term_save divisible by n_autocorr, autocorr_w_max >= 1 and a single chain\n",
+	   n_autocorr);
+    exit(1);
+  }
+  if(n_autocorr<0 || save_tau_factor<0 || (save_tau_factor > 0 && (n_autocorr == 0 || ensemble_file[0] == '\0'))) {
+    printf("Invalid n_autocorr=%d save_tau_factor=%f (save_tau_factor > 0 needs n_autocorr > 0 and ensemble_file)\n",
+	   n_autocorr, save_tau_factor);
+    exit(1);
+  }
+  if(n_overrelax<0 || n_overrelax >= rng_max_hit) {
+    printf("Invalid number of overrelaxation sweeps n_overrelax=%d (< %d, see \"rng.h\")\n", n_overrelax,
+	   rng_max_hit);
+    exit(1);
+  }
+  if(n_hit<1 || n_hit >= rng_max_hit) {
+    printf("Invalid number of hits n_hit=%d (1 <= n_hit < %d, see \"rng.h\")\n", n_hit, rng_max_hit);
+    exit(1);
+  }
+  volume = T*X*Y*Z;
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//     Print all parameters as "name = value" (e.g. into the metadata of the output), in     //
+//                            the format accepted by (II.):                                  //
+//                                                                                           //
+//###########################################################################################//
+
+void print_parameters(FILE *f) {
+
+  int i;
+
+  for(i=0;i<n_parameters;i++) {
+    switch(parameter_table[i].type) {
+    case 'i':
+      fprintf(f, "%s = %d\n", parameter_table[i].name, *(int *) parameter_table[i].value);
+      break;
+    case 'd':
+      fprintf(f, "%s = %.17g\n", parameter_table[i].name, *(double *) parameter_table[i].value);
+      break;
+    case 's':
+      fprintf(f, "%s = %s\n", parameter_table[i].name, *(const char **) parameter_table[i].value);
+      break;
+    }
+  }
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//              Function for the calculation of the parameters LAMBDA and KAPPA              //
+//       from m2_0 and lambda_c (needed for the calculation of the action S and as           //
+//     metadata for the correlation functions). calculate_couplings() does the same for      //
+//                  any other point (m2, lc), e.g. of a replica (see "replica.cpp"):         //
+//                                                                                           //
+//###########################################################################################//
+
+void calculate_couplings(double m2, double lc, double *p_lambda, double *p_kappa) {
+
+  double lambda, kappa;
+
+  lambda = (4*lc - (8+m2)*(-8 -m2 + sqrt(8*lc + (8+m2)*(8+m2)))  )/(8*lc);
+  kappa = (-8 - m2 + sqrt(8*lc + (8.0+m2)*(8.0+m2)) )/(4*lc);
+
+  if(kappa<0 || kappa>1) {
+    
+    lambda = (4*lc + (8+m2)*(8 +m2 + sqrt(8*lc + (8+m2)*(8+m2)))  )/(8*lc);
+    kappa = (-8 - m2 - sqrt(8*lc + (8.0+m2)*(8.0+m2)) )/(4*lc);
+    
+  }
+  *p_lambda = lambda;
+  *p_kappa  = kappa;
+}
+
+void calculate_parameters() {
+
+  calculate_couplings(m2_0, lambda_c, &LAMBDA, &KAPPA);
+}
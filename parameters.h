@@ -1,37 +1,51 @@
 #pragma once
 
+#include <stdio.h>
+
 static const double PI= 3.14159265359;
 
 //###########################################################################################################//
-//                                Choose the lattice volume with T, X, Y and Z:                              //
+//  All parameters below are read at runtime by read_parameters() (see "parameters.cpp"). The default values //
+//  given here can be changed in an input file with lines "name = value" ("./toytest input.txt") or on the   //
+//  command line ("./toytest --T 48 --X 14 --n_save 100"), so one build serves a full parameter scan.        //
 //###########################################################################################################//
 
-#define T 8
-#define X 6
-#define Y 6
-#define Z 6
+int read_parameters(int argc, char *argv[]);
+void print_parameters(FILE *f);
+
+
+//###########################################################################################################//
+//                     Choose the lattice volume with T, X, Y and Z (default 8, 6, 6, 6):                    //
+//   The kernels in "soa_field.cpp" are specialised at compile time for 6^3x8, 14^3x48 and 24^3x48 and       //
+//                use a generic fallback for all other lattice sizes (see "geometry.h"):                     //
+//###########################################################################################################//
 
-/*
-#define T 48
-#define X 14 //24
-#define Y 14 //24
-#define Z 14 //24
-*/
+extern int T;
+extern int X;
+extern int Y;
+extern int Z;
  
-#define volume T*X*Y*Z
+extern int volume;  // T*X*Y*Z
 
-// Parameters of theory in the continuum:
-#define m2_0 -4.9  //(A)
-#define lambda_c 10.0 //(A)
+// Parameters of theory in the continuum (default -4.9 and 10.0):
+extern double m2_0;
+extern double lambda_c;
 
-// Parameters of the action S:
+// Parameters of the action S (calculated from m2_0 and lambda_c by calculate_parameters()):
 extern double LAMBDA;
 extern double KAPPA;
+
+void calculate_parameters();
+void calculate_couplings(double m2, double lc, double *p_lambda, double *p_kappa);
  
 // Parameters needed in the Metropolis algorithm. In each step one makes one update in the magnitude
 // and phase of the field
 static const double deltaphi = 3.14159/16; //3.14159265359/8;
-static const double deltarho = 1;//1; //0.45;
+extern double deltarho; // default 1
+
+// Seed of all random numbers (see "rng.h" and "generator_singleton.h"). The checkerboard sweeps
+// (update_mode 1) give the same configurations for the same seed, whatever the number of threads:
+extern int seed; // default 0
 
 #define nprint_field 1000
 #define n_update_phi 1
@@ -39,25 +53,27 @@ static const double deltarho = 1;//1; //0.45;
 
 //###########################################################################################################//
 //      In main.cpp "start_random_conf" is needed in (II.J) in order to print a specific configuration:      //
-//     "fprint_field(phi, (long long) (i+1)*n_term_save + (long long) start_random_conf*(1-start_random))"   //
+//         "fprint_field(phi, (long long) (i+1)*n_term_save + (start_random == 0 ? start_random_conf : 0))"  //
 //###########################################################################################################//
 
-#define start_random_conf 0
+extern int start_random_conf; // default 0
 
 
 //###########################################################################################################//
 //       "n_save" is the number of saved phi field configurations called "scalar_X_Y_Z_T_n_(conf).txt":      //
 //###########################################################################################################//
 
-#define n_save 20
+extern int n_save; // default 20
 
 
 //###########################################################################################################//
 //          If start_random 0: The the file "start_conf" is chosen to be the start configuration.            //
 //          If start_random 1: Hot start, where a disordered, random configuration is utilized.              //
+//          If start_random 2: Cold start with the ordered configuration phi = 1 (see COLD START).           //
+//          If start_random 3: Mean field start, the constant field of minimal action (see COLD START).      //
 //###########################################################################################################//
 
-#define start_random 0
+extern int start_random; // default 0
 
 
 //###########################################################################################################//
@@ -65,29 +81,154 @@ static const double deltarho = 1;//1; //0.45;
 //   in "start_config". If "start_conf" is available, the program continues with the Metropolis algorithm:   //
 //###########################################################################################################//
 
-static const char *start_conf = "./start_config/scalar_6_6_6_8_6000.txt";
+extern const char *start_conf; // default "./start_config/scalar_6_6_6_8_6000.txt"
 
 
 //###########################################################################################################//
 //    HOT START (start_random 1):                                                                            //
 //    If we start with a disordered, random configuration (start_random 1), n_term_field is the number of    //
-//    steps until thermalization:                                                                            //
+//    steps until thermalization (at most, if n_therm_check > 0, see COLD START):                            //
+//###########################################################################################################//
+
+extern int n_term_field; // default 1000
+
+
 //###########################################################################################################//
+//   If n_tune > 0 the proposal width is tuned during the thermalisation: after every n_tune steps deltarho  //
+//   (Metropolis hits) or hmc_n_steps (update_mode 2) is adapted to the acceptance tune_acceptance or        //
+//   tune_acceptance_hmc, respectively. The tuned value is kept for all saved configurations and is stored   //
+//             in the checkpoint and the binary configurations (see "tune.cpp"):                             //
+//###########################################################################################################//
+
+extern int n_tune; // default 0 (no tuning)
+extern double tune_acceptance; // default 0.5
+extern double tune_acceptance_hmc; // default 0.8
+
 
-#define n_term_field 1000
+//###########################################################################################################//
+//    COLD START (start_random 2 and 3):                                                                     //
+//    The start configuration is ordered: phi = 1 everywhere (start_random 2) or phi = sqrt(rho)             //
+//    with rho = 1 - (1 - 8*KAPPA)/(2*LAMBDA) (0 if negative), the constant field of minimal action          //
+//    (start_random 3, see mean_field_magnitude() in "scalar.cpp"). Both are thermalised like a hot start,   //
+//    in the broken phase the mean field start is close to equilibrium and needs much fewer steps.           //
+//###########################################################################################################//
 
 
 //###########################################################################################################//
-//    COLD START:                                                                                            //
-//    Maybe later...                                                                                         //
+//    If n_therm_check > 0 the thermalisation of a hot or cold start stops before n_term_field steps once    //
+//    the action no longer drifts: it is measured every n_therm_check steps and the means of the last two    //
+//    sets of therm_window measurements have to agree within therm_z standard errors (see "thermalise.cpp"): //
 //###########################################################################################################//
 
+extern int n_therm_check; // default 0 (always n_term_field steps)
+extern int therm_window; // default 10
+extern double therm_z; // default 2
+
+
+//###########################################################################################################//
+//                        Choose the update scheme of the Metropolis algorithm:                              //
+// If update_mode == 0: In every Metropolis step, n_metropolis local updates are made at randomly chosen     //
+//                      lattice points (first all odd t, then all even t, see metropolis_core()).            //
+// If update_mode == 1: Deterministic checkerboard sweeps, where every lattice point is updated exactly once //
+//                      per sweep (first all even, then all odd sites (t+x+y+z), see metropolis_sweep()).    //
+//                      In this case n_term_field and n_term_save are numbers of sweeps.                     //
+// If update_mode == 2: Hybrid Monte Carlo, n_term_field and n_term_save are numbers of trajectories (see    //
+//                      hmc() in "hmc.cpp"). It needs n_hit = 1, n_overrelax = 0 and cluster_mode = 0.       //
+// Other values are rejected.                                                                                //
+//###########################################################################################################//
+
+extern int update_mode; // default 0
+
 
 //###########################################################################################################//
 //               Number of local updates in a single Metropolis step (see metropolis.cpp):                   //
 //###########################################################################################################//
 
-#define n_metropolis  250*10*4//650 //for L=18
+extern int n_metropolis; // default 250*10*4 (650 for L=18)
+
+
+//###########################################################################################################//
+//    Number of Metropolis hits per visit of a lattice point (both update modes). The neighbours are read    //
+//      once per visit and all n_hit proposals use the same neighbour sum (see update_site() in              //
+//                                          "metropolis.cpp"):                                               //
+//###########################################################################################################//
+
+extern int n_hit; // default 1
+
+
+//###########################################################################################################//
+//   Number of overrelaxation sweeps after every Metropolis step (sweep for update_mode 1, odd and even      //
+//   core for update_mode 0). They reflect every field point about the minimum of its local action, see      //
+//                                   overrelax_sweep() in "metropolis.cpp":                                  //
+//###########################################################################################################//
+
+extern int n_overrelax; // default 0 (below rng_max_hit, see "rng.h")
+
+
+//###########################################################################################################//
+//     Embedded Ising cluster updates of the phase of phi after every Metropolis step (see "cluster.cpp"):   //
+//       cluster_mode 0: none, 1: n_cluster Wolff single cluster updates, 2: n_cluster Swendsen-Wang updates //
+//###########################################################################################################//
+
+extern int cluster_mode; // default 0
+extern int n_cluster;    // default 1 (at most rng_max_hit/3, see "cluster.cpp")
+
+
+//###########################################################################################################//
+//  Hybrid Monte Carlo (update_mode 2): length hmc_tau and number of steps hmc_n_steps of a trajectory, the  //
+//   integrator (0: leapfrog, 1: Omelyan) and the number of steps hmc_n_inner of the local potential force   //
+//              per step of the hopping force (1: both forces on one time scale), see "hmc.cpp":             //
+//###########################################################################################################//
+
+extern double hmc_tau;     // default 1
+extern int hmc_n_steps;    // default 10
+extern int hmc_integrator; // default 1
+extern int hmc_n_inner;    // default 1
+
+
+//###########################################################################################################//
+//   Fourier acceleration of the HMC (hmc_fourier 1): the modes of momentum p move faster by the factor      //
+//   K_p = (hmc_fourier_mass2 + 16)/(hmc_fourier_mass2 + \hat p^2) (see "hmc.cpp" and "fft.cpp"):            //
+//###########################################################################################################//
+
+extern int hmc_fourier;          // default 0
+extern double hmc_fourier_mass2; // default 1
+
+
+//###########################################################################################################//
+//   Replica exchange (n_replica > 1): the replicas r = 0,...,n_replica-1 at m2_0 + r*replica_dm2_0 and      //
+//   lambda_c + r*replica_dlambda_c are updated at the same time by checkerboard Metropolis sweeps, one      //
+//   replica per thread. After every n_replica_swap sweeps the fields of neighbouring replicas are swapped   //
+//   with the probability min(1, exp(-\Delta S)) (see "replica.cpp"). The configurations of replica r are    //
+//   saved at "path_read/replica_r/"; checkpoints, resume and ensemble_file are not available. It needs      //
+//   update_mode 1 (the default 0 is switched to 1) without overrelaxation and cluster updates (other        //
+//   settings are rejected):                                                                                 //
+//###########################################################################################################//
+
+extern int n_replica;            // default 0
+extern double replica_dm2_0;     // default 0.1
+extern double replica_dlambda_c; // default 0
+extern int n_replica_swap;       // default 10
+
+
+//###########################################################################################################//
+//   Batched chains (n_chain > 1): n_chain independent chains with the seeds seed,...,seed+n_chain-1 are     //
+//   updated side by side by checkerboard sweeps (as update_mode 1 without overrelaxation and cluster        //
+//   updates), with the chains as vectorised lanes of every lattice point (see "chains.cpp"). Chain c is     //
+//   saved at "path_read/chain_c/" (or in "path_read/chain_c/ensemble_file"); no resume, and no checkpoints  //
+//   are written (n_checkpoint is ignored, as for replicas). It needs update_mode 1 (the default 0 is        //
+//   switched to 1), n_overrelax = 0 and cluster_mode = 0 (else rejected):                                   //
+//###########################################################################################################//
+
+extern int n_chain; // default 1
+
+
+//###########################################################################################################//
+//   The action printed by metropolis() is a running sum of the accepted changes (see "metropolis.cpp").     //
+//       Every n_action_check calls it is measured from scratch to remove rounding errors (0: never):        //
+//###########################################################################################################//
+
+extern int n_action_check; // default 0
 
 
 //###########################################################################################################//
@@ -96,7 +237,51 @@ static const char *start_conf = "./start_config/scalar_6_6_6_8_6000.txt";
 //               the field configurations computed in "main.c" are multiplied with n_term_save:              //
 //###########################################################################################################//
 
-#define n_term_save 1*1000 //10000
+extern int n_term_save; // default 1000
+
+
+//###########################################################################################################//
+//  Online autocorrelation analysis (n_autocorr > 0, see "autocorr.cpp"): between the saved configurations   //
+//  the action, |phi|^2 and the zero momentum correlator are measured every n_autocorr steps and their       //
+//  integrated autocorrelation times are estimated by the Gamma method with a window of at most              //
+//  autocorr_w_max measurements. If save_tau_factor > 0 the number of steps between two saved configurations //
+//  is then save_tau_factor times the largest tau_int. The configurations carry their true step numbers, so  //
+//  this needs an ensemble_file; "calculate_corr.cpp" then reads its records in order:                       //
+//###########################################################################################################//
+
+extern int n_autocorr; // default 0 (no measurements)
+extern int autocorr_w_max; // default 200
+extern double save_tau_factor; // default 0 (n_term_save steps between the configurations)
+
+
+//###########################################################################################################//
+//  Format of the saved field configurations (see "field_io.cpp"):                                           //
+//  If field_format == 0: text files "scalar_X_Y_Z_T_(n_conf).txt" (columns x y z t re im, see fprint_field) //
+//  If field_format == 1: binary files "scalar_X_Y_Z_T_(n_conf).bin" with a header and double precision data //
+//  If field_format == 2: binary files as for 1 with single precision data                                   //
+//###########################################################################################################//
+
+extern int field_format; // default 0
+
+
+//###########################################################################################################//
+//  If ensemble_file is not empty, all field configurations are appended to the single ensemble file         //
+//  "path_read/ensemble_file" (binary records in the format chosen by field_format 1 or 2, see               //
+//  "ensemble.cpp") by "calculate_toytest.cpp" and read from there by "calculate_corr.cpp":                  //
+//###########################################################################################################//
+
+extern const char *ensemble_file; // default ""
+
+
+//###########################################################################################################//
+//  Checkpoints of the Markov chain (see "checkpoint.cpp"): "calculate_toytest.cpp" writes the field and the //
+//  state of the chain to checkpoint_file after every n_checkpoint saved configurations (0: never). If       //
+//  resume == 1 (or with the option --resume), the chain is continued from checkpoint_file:                  //
+//###########################################################################################################//
+
+extern const char *checkpoint_file; // default "checkpoint.dat"
+extern int n_checkpoint;            // default 1
+extern int resume;                  // default 0
 
 
 //###########################################################################################################//
@@ -104,7 +289,7 @@ static const char *start_conf = "./start_config/scalar_6_6_6_8_6000.txt";
 //  in "calculate_corr.c" this path is used to read in the fields for the creation of correlation functions: //
 //###########################################################################################################//
 
-static const char *path_read = "./field_configs/";
+extern const char *path_read; // default "./field_configs/"
 
 
 //###########################################################################################################//
@@ -112,7 +297,7 @@ static const char *path_read = "./field_configs/";
 //        the correlation functions will be printed) is created (the path must end with "/name-of-folder/"): //
 //###########################################################################################################//
 
-static const char *path_corr = "./corr_analysis/";
+extern const char *path_corr; // default "./corr_analysis/"
 
 
 //###########################################################################################################//
@@ -120,7 +305,7 @@ static const char *path_corr = "./corr_analysis/";
 //                      calculated in "operators.c" and "calculate_corr.c", respectively:                    //
 //###########################################################################################################//
 
-#define n_fields 5
+extern int n_fields; // default 5
 
 
 //###########################################################################################################//
@@ -128,7 +313,7 @@ static const char *path_corr = "./corr_analysis/";
 //functions (number must be chosen n_analyse = n_save-1 where n_save is the number of created field configs)://
 //###########################################################################################################//
 
-#define n_analyse 20//100000 //36000
+extern int n_analyse; // default 20
 
 
 //###########################################################################################################//
@@ -137,7 +322,7 @@ static const char *path_corr = "./corr_analysis/";
 //                                   all correlation functions are printed:                                  //
 //###########################################################################################################//
 
-#define n_restrict 1
+extern int n_restrict; // default 1
 
 
 //###########################################################################################################//
@@ -145,5 +330,16 @@ static const char *path_corr = "./corr_analysis/";
 // If correlator == 1: derivative of n particle correlation function is utilized in "calculate_corr.cpp"     //
 //###########################################################################################################//
 
-#define correlator 1
+extern int correlator; // default 1
+
+
+//###########################################################################################################//
+//  Pipeline of the analysis in "calculate_corr.cpp" (see "analysis.cpp"): n_readers threads load the        //
+//  configurations into a queue of queue_depth configurations, from which n_workers threads calculate the    //
+//          correlation functions of whole configurations (n_workers = 0: OMP_NUM_THREADS workers):          //
+//###########################################################################################################//
+
+extern int n_readers;   // default 1
+extern int n_workers;   // default 0
+extern int queue_depth; // default 4
 
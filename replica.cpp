@@ -0,0 +1,344 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "parameters.h"
+#include "geometry.h"
+#include "action.h"
+#include "scalar.h"
+#include "field_io.h"
+#include "metropolis.h"
+#include "rng.h"
+#include "replica.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Replica exchange (parallel tempering, n_replica > 1): the replicas r = 0,...,n_replica-1  //
+// are Markov chains at the points (m2_0 + r*replica_dm2_0, lambda_c + r*replica_dlambda_c)  //
+// with their own LAMBDA and KAPPA. Every replica is updated by checkerboard Metropolis      //
+// sweeps on one thread, the replicas are split dynamically across the threads, so many      //
+// small lattices fill all cores. After n_replica_swap sweeps the fields of the neighbouring //
+// replicas r, r+1 (r even and odd in turn) are swapped with the probability                 //
+// min(1, exp(-\Delta S)), \Delta S = S_r(phi_{r+1}) + S_{r+1}(phi_r) - S_r(phi_r) -         //
+// S_{r+1}(phi_{r+1}), where S_r is the action of eval_action_nogauge() with the couplings   //
+// of r. It is linear in LAMBDA and KAPPA, so the sums of the field in struct replica give   //
+// it for any point without reading the field again.                                         //
+//                                                                                           //
+// The random numbers of the sweep "step" of replica r are those of update_mode 1 with the   //
+// purposes rng_replica_purpose(.., r), the swap of the pair r, r+1 after the sweep "step"   //
+// uses rng_swap at site r (see "rng.h"), so the replicas do not depend on the number of     //
+// threads or the order in which they are updated.                                           //
+//                                                                                           //
+//*******************************************************************************************//
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   The replicas start from copies of the field phi. The configurations of replica r are    //
+//     saved at "path_read/replica_r/" with its LAMBDA and KAPPA (see "field_io.cpp"):       //
+//                                                                                           //
+//###########################################################################################//
+
+int init_replicas(replica_set *rs, scalar_field phi) {
+
+  struct stat st = {0};
+  replica *p;
+  int r;
+
+  memset(rs, 0, sizeof(replica_set));
+  rs->n          = n_replica;
+  rs->r          = (replica *) calloc(rs->n, sizeof(replica));
+  rs->n_swap_try = (long *) calloc(rs->n, sizeof(long));
+  rs->n_swap_acc = (long *) calloc(rs->n, sizeof(long));
+  rs->direction  = (int *) calloc(rs->n, sizeof(int));
+
+  for(r=0;r<rs->n;r++) {
+
+    p = &rs->r[r];
+    p->m2_0     = m2_0 + r*replica_dm2_0;
+    p->lambda_c = lambda_c + r*replica_dlambda_c;
+    if(p->lambda_c <= 0) {
+      printf("Replica %d has lambda_c = %f <= 0\n", r, p->lambda_c);
+      exit(1);
+    }
+    calculate_couplings(p->m2_0, p->lambda_c, &p->lambda, &p->kappa);
+
+    p->phi = (scalar_field) malloc(volume * sizeof(complex));
+    memcpy(p->phi, phi, volume * sizeof(complex));
+    p->walker = r;
+
+    snprintf(p->path, sizeof(p->path), "%s/replica_%d", path_read, r);
+    if(stat(p->path, &st) == -1) {
+      mkdir(p->path, 0700);
+    }
+
+    printf("replica %d: m2_0 = %f, lambda_c = %f, Lambda = %f, Kappa = %f \n", r, p->m2_0,
+	   p->lambda_c, p->lambda, p->kappa);
+  }
+  rs->direction[0] = 1;
+  return 0;
+}
+
+void free_replicas(replica_set *rs) {
+
+  int r;
+
+  for(r=0;r<rs->n;r++) {
+    free(rs->r[r].phi);
+  }
+  free(rs->r);
+  free(rs->n_swap_try);
+  free(rs->n_swap_acc);
+  free(rs->direction);
+}
+
+void replica_save(replica_set *rs, long long n_conf) {
+
+  const char *path = path_read;
+  double lambda = LAMBDA, kappa = KAPPA;
+  int r;
+
+  for(r=0;r<rs->n;r++) {
+    path_read = rs->r[r].path;
+    LAMBDA    = rs->r[r].lambda;
+    KAPPA     = rs->r[r].kappa;
+
+    if(field_format == 0) {
+      fprint_field(rs->r[r].phi, n_conf);
+    }
+    else {
+      fprint_field_binary(rs->r[r].phi, n_conf, (field_format == 2 ? 4 : 8));
+    }
+  }
+
+  path_read = path;
+  LAMBDA    = lambda;
+  KAPPA     = kappa;
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   One checkerboard sweep of the replica number "index" (same update as metropolis_sweep() //
+//   in "metropolis.cpp", but on one thread and with the couplings of the replica) and the   //
+//       sums of its field. The number of accepted hits of the sweep is returned:            //
+//                                                                                           //
+//###########################################################################################//
+
+static long replica_sweep(replica *p, int index, long long step, double *u_proposal,
+			  double *u_accept) {
+
+  long const n = volume/2;
+  long k, acc = 0;
+  int ipt, parity, hit;
+  complex phi_x, phi_new, b;
+
+  for(parity=0;parity<2;parity++) {
+
+    for(hit=0;hit<n_hit;hit++) {
+      rng_uniform_bulk(step, rng_replica_purpose(rng_hit_purpose(rng_proposal,hit), index),
+		       parity_sites[parity], 0, n, u_proposal + 2*n*hit);
+    }
+    for(hit=0;hit<n_hit;hit+=2) {
+      rng_uniform_bulk(step, rng_replica_purpose(rng_hit_purpose(rng_accept,hit), index),
+		       parity_sites[parity], 0, n, u_accept + n*hit);
+    }
+
+    for(k=0;k<n;k++) {
+
+      ipt = parity_sites[parity][k];
+      phi_x = p->phi[ipt];
+      b = neighbour_sum(p->phi,ipt);
+
+      for(hit=0;hit<n_hit;hit++) {
+	phi_new.re = phi_x.re - deltarho + 2*deltarho * u_proposal[2*(hit*n + k)];
+	phi_new.im = phi_x.im - deltarho + 2*deltarho * u_proposal[2*(hit*n + k)+1];
+
+	if(exp(-local_delta_action_at(phi_x,phi_new,b,p->kappa,p->lambda)) > u_accept[2*((hit/2)*n + k) + rng_pair_index(hit)]) {
+	  phi_x = phi_new;
+	  acc++;
+	}
+      }
+      p->phi[ipt] = phi_x;
+    }
+  }
+  return acc;
+}
+
+static void measure_replica(replica *p) {
+
+  double sum_quartic = 0., phi2 = 0., hopping = 0., rho;
+  int ipt, mu;
+
+  for(ipt=0;ipt<volume;ipt++) {
+
+    rho = p->phi[ipt].re*p->phi[ipt].re + p->phi[ipt].im*p->phi[ipt].im;
+    sum_quartic += (rho - 1)*(rho - 1);
+    phi2        += rho;
+
+    // Forward neighbours only, so that every link is counted once (see "geometry.h"):
+    for(mu=0;mu<4;mu++) {
+      hopping += p->phi[ipt].re*p->phi[neighbour(ipt,mu)].re
+	+ p->phi[ipt].im*p->phi[neighbour(ipt,mu)].im;
+    }
+  }
+
+  p->sum_quartic = sum_quartic;
+  p->phi2        = phi2;
+  p->hopping     = hopping;
+}
+
+static inline double replica_action(replica const *p) {
+  return p->lambda*p->sum_quartic + p->phi2 - 2*p->kappa*p->hopping;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Swaps of the pairs r, r+1 with even (odd) r in even (odd) rounds after the sweep        //
+//   "step". Only the fields and their sums move, the couplings stay with the replica. A     //
+//   walker (field) that reaches replica 0 after replica n-1 has made a round trip:          //
+//                                                                                           //
+//###########################################################################################//
+
+static void swap_replicas(replica_set *rs, long long step) {
+
+  replica *p, *q, aux;
+  double deltaS, u[2];
+  int r, walker;
+
+  for(r=(int) (rs->n_rounds%2);r<rs->n-1;r+=2) {
+
+    p = &rs->r[r];
+    q = &rs->r[r+1];
+    deltaS = (p->lambda - q->lambda)*(q->sum_quartic - p->sum_quartic)
+      - 2*(p->kappa - q->kappa)*(q->hopping - p->hopping);
+
+    rng_uniform(step, rng_swap, r, u);
+    rs->n_swap_try[r]++;
+
+    if(exp(-deltaS) > u[0]) {
+      aux = *p;
+      p->phi = q->phi;  p->walker = q->walker;  p->sum_quartic = q->sum_quartic;
+      p->phi2 = q->phi2;  p->hopping = q->hopping;
+      q->phi = aux.phi;  q->walker = aux.walker;  q->sum_quartic = aux.sum_quartic;
+      q->phi2 = aux.phi2;  q->hopping = aux.hopping;
+      rs->n_swap_acc[r]++;
+    }
+  }
+
+  walker = rs->r[0].walker;
+  if(rs->direction[walker] == -1) {
+    rs->n_round_trips++;
+  }
+  rs->direction[walker] = 1;
+
+  walker = rs->r[rs->n-1].walker;
+  if(rs->direction[walker] == 1) {
+    rs->direction[walker] = -1;
+  }
+  rs->n_rounds++;
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//   n_field sweeps of every replica with a swap round after every n_replica_swap sweeps.    //
+//   The rounds follow the sweeps "step" with (step+1)%n_replica_swap == 0, so a part of     //
+//   n_replica_swap sweeps left at the end of a call is completed by the next one and the    //
+//   swaps do not depend on n_field. One team of threads is started for all rounds, the      //
+//   replicas of a round are distributed dynamically and the master thread makes the swaps   //
+//   in between. The actions of all replicas are written to faction, the mean acceptance is  //
+//                                        returned:                                          //
+//                                                                                           //
+//###########################################################################################//
+
+double replica_exchange(replica_set *rs, int n_field, FILE *faction) {
+
+  long const n_u = 2 * (long) n_hit * (volume/2);
+  long n_acc = 0, n_site = 0;
+  int r;
+  double time0 = omp_get_wtime();
+
+  for(r=0;r<rs->n;r++) {
+    rs->r[r].n_acc  = 0;
+    rs->r[r].n_site = 0;
+    rs->n_swap_try[r] = 0;
+    rs->n_swap_acc[r] = 0;
+  }
+
+#pragma omp parallel
+  {
+    double *u_proposal = (double *) malloc(n_u * sizeof(double));
+    double *u_accept   = (double *) malloc(n_u * sizeof(double));
+    int start, length, i, index;
+
+    for(start=0;start<n_field;start+=length) {
+
+      // Up to the next sweep of the grid, which may lie in a later call:
+      length = n_replica_swap - (int) ((sweep_count + start)%n_replica_swap);
+      if(length > n_field - start) {
+	length = n_field - start;
+      }
+
+#pragma omp for schedule(dynamic,1)
+      for(index=0;index<rs->n;index++) {
+	replica *p = &rs->r[index];
+
+	for(i=0;i<length;i++) {
+	  p->n_acc += replica_sweep(p, index, sweep_count + start + i, u_proposal, u_accept);
+	}
+	p->n_site += (long) length*volume*n_hit;
+	measure_replica(p);
+      }
+
+      if((sweep_count + start + length)%n_replica_swap == 0) {
+#pragma omp single
+	swap_replicas(rs, sweep_count + start + length - 1);
+      }
+    }
+
+    free(u_proposal);
+    free(u_accept);
+  }
+  sweep_count += n_field;
+
+  double time1 = omp_get_wtime();
+
+  printf("=====================================================\n");
+  printf("Replica sweeps = %d, swap rounds = %lld \n", n_field, rs->n_rounds);
+  for(r=0;r<rs->n;r++) {
+    replica *p = &rs->r[r];
+
+    printf("replica %d: action = %f, <|phi|^2> = %f, hopping = %f, acceptance = %f, field %d \n",
+	   r, replica_action(p), p->phi2/volume, p->hopping/volume, (double) p->n_acc/p->n_site,
+	   p->walker);
+    if(faction != NULL) {
+      fprintf(faction, "%e%s", replica_action(p), (r < rs->n-1 ? " " : "\n"));
+    }
+    n_acc  += p->n_acc;
+    n_site += p->n_site;
+  }
+  for(r=0;r<rs->n-1;r++) {
+    if(rs->n_swap_try[r] > 0) {
+      printf("swap %d <-> %d: acceptance = %f \n", r, r+1,
+	     (double) rs->n_swap_acc[r]/rs->n_swap_try[r]);
+    }
+  }
+  printf("round trips = %ld \n", rs->n_round_trips);
+  printf("replica sweeps per second = %f \n", (double) rs->n*n_field/(time1-time0));
+
+  return (double) n_acc/n_site;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "types.h"
+
+// One point of the replica exchange (see "replica.cpp") and the field currently at that point.
+// The action of a field at the point is lambda*sum_quartic + phi2 - 2*kappa*hopping:
+struct replica {
+  double m2_0, lambda_c;   // m2_0 + r*replica_dm2_0, lambda_c + r*replica_dlambda_c
+  double lambda, kappa;    // LAMBDA and KAPPA of the point (see calculate_couplings())
+  scalar_field phi;        // field at the point, exchanged with the neighbours by swaps
+  int walker;              // number of the field (the replica it started at)
+  char path[512];          // directory of the saved configurations
+
+  double sum_quartic;      // sum_x (|phi_x|^2 - 1)^2
+  double phi2;             // sum_x |phi_x|^2
+  double hopping;          // sum_x sum_{mu forward} Re(phi_x^* phi_{x+mu})
+
+  long n_acc, n_site;      // accepted and proposed Metropolis hits of the current call
+};
+
+struct replica_set {
+  int n;                   // n_replica
+  replica *r;
+  long *n_swap_try;        // swaps of the pair (r, r+1) tried and accepted in the current call
+  long *n_swap_acc;
+  int *direction;          // walker: +1 if it was at replica 0 last, -1 if at replica n-1 since
+  long n_round_trips;      // walkers from replica 0 to n-1 and back since the start
+  long long n_rounds;      // swap rounds since the start
+};
+
+int init_replicas(replica_set *rs, scalar_field phi);
+void free_replicas(replica_set *rs);
+double replica_exchange(replica_set *rs, int n_field, FILE *faction);
+void replica_save(replica_set *rs, long long n_conf);
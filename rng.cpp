@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "parameters.h"
+#include "rng.h"
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   The key of all random numbers is the parameter seed (see "parameters.h"), the counter   //
+//           is made of the lattice point, the step and the purpose (see "rng.h"):           //
+//                                                                                           //
+//###########################################################################################//
+
+void rng_uniform(long long step, int purpose, long site, double *u) {
+
+  uint32_t key[2] = {(uint32_t) seed, (uint32_t) ((uint64_t) seed >> 32)};
+  uint32_t ctr[4] = {(uint32_t) site, (uint32_t) step, (uint32_t) ((uint64_t) step >> 32),
+		     (uint32_t) purpose};
+
+  philox4x32_10(ctr, key);
+  u[0] = rng_to_double(ctr[0], ctr[1]);
+  u[1] = rng_to_double(ctr[2], ctr[3]);
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//   Bulk generation for many sites. The rounds of Philox only need 32x32 -> 64 bit          //
+//   products, xors and additions, so the compiler processes SIMD_WIDTH sites at once:       //
+//                                                                                           //
+//###########################################################################################//
+
+void rng_uniform_bulk(long long step, int purpose, int const *sites, long first, long n,
+		      double *u) {
+
+  uint32_t const key[2] = {(uint32_t) seed, (uint32_t) ((uint64_t) seed >> 32)};
+  uint32_t const step_lo = (uint32_t) step, step_hi = (uint32_t) ((uint64_t) step >> 32);
+  long k;
+
+  for(k=0;k<n;k++) {
+
+    uint32_t ctr[4] = {(uint32_t) (sites != NULL ? sites[k] : first + k), step_lo, step_hi,
+		       (uint32_t) purpose};
+
+    philox4x32_10(ctr, key);
+    u[2*k]   = rng_to_double(ctr[0], ctr[1]);
+    u[2*k+1] = rng_to_double(ctr[2], ctr[3]);
+  }
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//   Bulk generation for n_lanes chains with the seeds seed0 + c (c < n_lanes, see           //
+//   "chains.cpp"). The lanes of one site are neighbours in u, so the loop over c is         //
+//                                       vectorised:                                         //
+//                                                                                           //
+//###########################################################################################//
+
+void rng_uniform_lanes(int seed0, int n_lanes, long long step, int purpose, int const *sites,
+		       long first, long n, double *u) {
+
+  uint32_t const step_lo = (uint32_t) step, step_hi = (uint32_t) ((uint64_t) step >> 32);
+  long k;
+  int c;
+
+  for(k=0;k<n;k++) {
+
+    uint32_t const site = (uint32_t) (sites != NULL ? sites[k] : first + k);
+    double *u_k = u + 2*k*n_lanes;
+
+#pragma omp simd
+    for(c=0;c<n_lanes;c++) {
+
+      int const s = seed0 + c;
+      uint32_t c0 = site, c1 = step_lo, c2 = step_hi, c3 = (uint32_t) purpose;
+
+      philox4x32_10_words(&c0, &c1, &c2, &c3, (uint32_t) s, (uint32_t) ((uint64_t) s >> 32));
+      u_k[2*c]   = rng_to_double(c0, c1);
+      u_k[2*c+1] = rng_to_double(c2, c3);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+// Counter-based random numbers (Philox4x32-10, see "rng.cpp"). Every random number is a pure
+// function of (seed, step, site, purpose): it does not depend on the thread that draws it or
+// on the order in which the sites are visited, so a chain is bit-identical for any number of
+// threads. step is the number of the sweep (see sweep_count in "metropolis.h"), site the
+// lattice point ipt and purpose one of the following streams:
+enum rng_purpose {
+  rng_init     = 0,   // phases of the random start configuration
+  rng_proposal = 1,   // proposed change of a field point (re, im)
+  rng_accept   = 2,   // accept/reject decision of the proposal
+  rng_overrelax = 3,  // accept/reject decision of an overrelaxation update
+  rng_cluster   = 4,  // direction, bonds and flips of a cluster update (see "cluster.cpp")
+  rng_hmc       = 5,  // momenta and accept/reject decision of an HMC trajectory (see "hmc.cpp")
+  rng_swap      = 6   // accept/reject decision of a replica swap (see "replica.cpp")
+};
+
+// Purpose of the hit "hit" of a multi-hit update (see n_hit in "parameters.h"). Hit 0 uses the
+// plain purpose, so the streams of a single hit do not change. hit has the bits 8-15, so it
+// must be below rng_max_hit (checked by read_parameters()), else its streams would be those
+// of another replica (see rng_replica_purpose()):
+#define rng_max_hit 256
+
+static inline int rng_hit_purpose(int purpose, int hit) {
+  return purpose + (hit << 8);
+}
+
+// An accept/reject decision needs only one number, so the two numbers u[0], u[1] of one site
+// and of the stream rng_hit_purpose(purpose, 2*j) are the decisions of the hits (or sweeps)
+// 2*j and 2*j+1, the hit "hit" uses u[rng_pair_index(hit)]:
+static inline int rng_pair_index(int hit) {
+  return hit & 1;
+}
+
+// Purpose of the stream "purpose" (or rng_hit_purpose()) of the replica number "replica" of a
+// replica exchange (see "replica.cpp"). Replica 0 uses the plain purpose:
+static inline int rng_replica_purpose(int purpose, int replica) {
+  return purpose + (replica << 16);
+}
+
+// The 4x32 bit counter (site, step, step >> 32, purpose) is encrypted with the 2x32 bit key
+// (seed, seed >> 32) in 10 rounds. The counter words are passed one by one, so a loop over
+// many counters keeps them in (vector) registers (see rng_uniform_lanes()):
+static inline void philox4x32_10_words(uint32_t *c0, uint32_t *c1, uint32_t *c2, uint32_t *c3,
+				       uint32_t k0, uint32_t k1) {
+
+  uint32_t x0 = *c0, x1 = *c1, x2 = *c2, x3 = *c3;
+  uint64_t p0, p1;
+  int round;
+
+  for(round=0;round<10;round++) {
+    p0 = (uint64_t) 0xD2511F53u * x0;
+    p1 = (uint64_t) 0xCD9E8D57u * x2;
+    x0 = (uint32_t) (p1 >> 32) ^ x1 ^ k0;
+    x1 = (uint32_t) p1;
+    x2 = (uint32_t) (p0 >> 32) ^ x3 ^ k1;
+    x3 = (uint32_t) p0;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  *c0 = x0;
+  *c1 = x1;
+  *c2 = x2;
+  *c3 = x3;
+}
+
+static inline void philox4x32_10(uint32_t ctr[4], uint32_t const key[2]) {
+  philox4x32_10_words(&ctr[0], &ctr[1], &ctr[2], &ctr[3], key[0], key[1]);
+}
+
+// Uniform double in [0,1) with 53 random bits:
+static inline double rng_to_double(uint32_t hi, uint32_t lo) {
+  return (double) ((((uint64_t) hi << 32) | lo) >> 11) * (1.0/9007199254740992.0);
+}
+
+// Two uniform numbers u[0], u[1] in [0,1) for one site:
+void rng_uniform(long long step, int purpose, long site, double *u);
+
+// Two uniform numbers u[2*k], u[2*k+1] for each of the n sites sites[k] (or first+k if sites
+// is NULL). The loop has no dependencies between the sites and is vectorised:
+void rng_uniform_bulk(long long step, int purpose, int const *sites, long first, long n,
+		      double *u);
+
+// The same for n_lanes chains with the seeds seed0, seed0+1, ...: u[2*(k*n_lanes + c)] and
+// u[2*(k*n_lanes + c)+1] of chain c at the site k:
+void rng_uniform_lanes(int seed0, int n_lanes, long long step, int purpose, int const *sites,
+		       long first, long n, double *u);
@@ -5,13 +5,13 @@
 #include <omp.h>
 #include <time.h>
 
-#include <random>
 #include <iostream>
 
 #include "action.h"
 #include "parameters.h"
 #include "types.h"
-#include "generator_singleton.h"
+#include "field_io.h"
+#include "rng.h"
 
 
 
@@ -59,10 +59,9 @@ int lattice_point(int t, int x, int y, int z) {
 
 //###########################################################################################//
 // (II.)                                                                                     //
-//           Random initialization in "metropolis.cpp", "calculate_toytest.cpp" and          //
-//     "calculate_corr.cpp" of the lattice field phi (and phi2) consisting of two arrays     //
-//            containing the real and imaginary components for all lattice points            //
-//                          "lattice_point(t,x,y,z)", respectively:                          //
+//    Random initialization in "calculate_toytest.cpp" and "calculate_corr.cpp" of the       //
+//    lattice field phi consisting of the real and imaginary components for all lattice      //
+//                             points "lattice_point(t,x,y,z)":                              //
 //                                                                                           //
 //###########################################################################################//
 
@@ -81,54 +80,51 @@ int initialize_field(scalar_field *p_aux) {   // typedef of scalar_field in type
                                                                
   scalar_field aux = *p_aux; // typedef of scalar_field in "types.h"
   double random;
-  int t,x,y,z;
+  int ipt;
 
+  // The phases are counter-based random numbers of the lattice points (see "rng.h"), so the
+  // start configuration only depends on the seed:
+  double *u = (double *) malloc(2*volume * sizeof(double));
+  rng_uniform_bulk(0, rng_init, NULL, 0, volume, u);
   
-  // "ZeroOne_distribution()" generates real numbers uniformly distr. between 0 and 1:
-  auto ZeroOne_distribution = std::uniform_real_distribution<double>(0.0,1.0);
-  
-  
-  for(t=0;t<T;t++) {
-    for(x=0;x<X;x++) {
-      for(y=0;y<Y;y++) {
-	for(z=0;z<Z;z++) {
-
-	  // get() is the thread number dependend mersenne twister defined in the class
-	  // "GeneratorSingleton" in "generator_singleton.h":
-	  random = 2 * PI * ZeroOne_distribution(GeneratorSingleton::get());
-	  
-	  aux[lattice_point(t,x,y,z)].re =  cos(random) ; // array containing real components
-	  aux[lattice_point(t,x,y,z)].im =  sin(random) ; // array containing imag. components
-
-	}
-      }
-    }
+  for(ipt=0;ipt<volume;ipt++) {
+    
+    random = 2 * PI * u[2*ipt];
+    
+    aux[ipt].re =  cos(random) ; // array containing real components
+    aux[ipt].im =  sin(random) ; // array containing imag. components
   }
+  
+  free(u);
+  return 0;
 }
 
+// Ordered start configurations (start_random 2 and 3, see "parameters.h"): phi = magnitude at
+// every lattice point. mean_field_magnitude() is the constant field that minimises the action
+// LAMBDA*(rho - 1)^2 + rho - 8*KAPPA*rho per lattice point (rho = |phi|^2, 4 forward links),
+// i.e. rho = 1 - (1 - 8*KAPPA)/(2*LAMBDA), or 0 in the symmetric phase:
+double mean_field_magnitude(void) {
 
+  double rho = 1 - (1 - 8*KAPPA)/(2*LAMBDA);
 
-//###########################################################################################//
-// (III.)                                                                                    //
-//        This function copies one single complex field point by taking a scalar field       //
-//        point p_old and replacing it with p_new (This is applied in the MC algorithm       // 
-//       "metropolis.cpp" (I.) and (II.) when an updated field point phi2 is accepted):      //
-//                                                                                           //
-//###########################################################################################//
+  return (rho > 0 ? sqrt(rho) : 0.);
+}
 
-int copy_field_point(scalar_field *p_old, scalar_field *p_new, int t, int x, int y, int z) {
+int ordered_field(scalar_field aux, double magnitude) {
 
-  scalar_field aux   = *p_old; // typedef of scalar_field in "types.h"
-  scalar_field aux2  = *p_new;	    
+  int ipt;
 
-  aux[lattice_point(t,x,y,z)].re = aux2[lattice_point(t,x,y,z)].re;
-  aux[lattice_point(t,x,y,z)].im = aux2[lattice_point(t,x,y,z)].im;
+  for(ipt=0;ipt<volume;ipt++) {
+    aux[ipt].re = magnitude;
+    aux[ipt].im = 0.;
+  }
+  return 0;
 }
 
 
 
 //###########################################################################################//
-// (IV.)                                                                                     //
+// (III.)                                                                                    //
 //    This function copies an entire field since the for loops over t,x,y,z are included.    //
 //       It replaces all scalar field points in space-time p_old and with p_new. This        //
 //     function is applied in the MC algorithm in the course of the initialization of the    //
@@ -141,60 +137,20 @@ int copy_field(scalar_field *p_old, scalar_field *p_new) {
   scalar_field aux  = *p_old; // typedef of scalar_field in "types.h"
   scalar_field aux2 = *p_new;
   
-  int t,x,y,z;
-  double temp, temp2;
+  int ipt;
   
-  //  #pragma omp parallel for private(t,x,y,z) shared(aux,aux2,temp,temp2)
-  for(t=0;t<T;t++) {
-    for(x=0;x<X;x++) {
-      for(y=0;y<Y;y++) {
-	for(z=0;z<Z;z++) {
-
-	  temp  = aux2[lattice_point(t,x,y,z)].re;
-	  temp2 = aux2[lattice_point(t,x,y,z)].im;
-	  aux[lattice_point(t,x,y,z)].re = temp;
-	  aux[lattice_point(t,x,y,z)].im = temp2;
-	}
-      }
-    }
+  // Every lattice point ipt = lattice_point(t,x,y,z) is visited once in memory order:
+  for(ipt=0;ipt<volume;ipt++) {
+    aux[ipt].re = aux2[ipt].re;
+    aux[ipt].im = aux2[ipt].im;
   }
+  return 0;
 }
 
 
 
 //###########################################################################################//
-// (V.)                                                                                      //
-//         This function updates one single field point by calculating a small change        //
-//               of the field point *p_aux (It is applied in "metropolis.cpp"):              //
-//      "ZeroOne_distribution" generates real numbers uniformly distr. between 0 and 1.      //
-//                                                                                           //
-//###########################################################################################//
-
-void update_field_point(scalar_field *p_aux, int t, int x, int y, int z) {
-
-  int i;
-  double phase, module;
-  complex random, caux;
-  scalar_field aux = *p_aux; // typedef of scalar_field in "types.h"
-
-  
-  // "ZeroOne_distribution()" generates real numbers uniformly distr. between 0 and 1:
-  auto ZeroOne_distribution = std::uniform_real_distribution<double>(0.0,1.0);
-
-  // get() is the thread number dependend mersenne twister defined in the class
-  // "GeneratorSingleton" in "generator_singleton.h":
-  random.re = aux[lattice_point(t,x,y,z)].re - deltarho + 2*deltarho * ZeroOne_distribution(GeneratorSingleton::get());  
-  random.im = aux[lattice_point(t,x,y,z)].im - deltarho + 2*deltarho * ZeroOne_distribution(GeneratorSingleton::get());
-  
-  aux[lattice_point(t,x,y,z)].re = random.re;
-  aux[lattice_point(t,x,y,z)].im = random.im;
-
-}
-
-
-
-//###########################################################################################//
-// (VI.)                                                                                     //
+// (IV.)                                                                                     //
 //      In "calculate_toytest.cpp" (II.I,J) this function builds the field configuration     //
 //    files "scalar_X_Y_Z_T_(n_conf).txt" which are read in in "calculate_corr.cpp" (II.).   //
 //      It prints all possible combinations of the lattice components t,x,y,z as well as     //
@@ -205,7 +161,7 @@ void update_field_point(scalar_field *p_aux, int t, int x, int y, int z) {
 
 int fprint_field(scalar_field phiaux, long long n_conf) {
 
-  char filename[40]="";
+  char filename[200]="";
   int x,y,z,t;
   double real, imaginary;
   FILE * fs;
@@ -246,16 +202,23 @@ int fprint_field(scalar_field phiaux, long long n_conf) {
 
 
 //###########################################################################################//
-// (VII.)                                                                                    //
+// (V.)                                                                                      //
 //  This functions is utilized in "calculate_toytest.cpp" to read in the start configuration //
 //       (start_conf) stored in a txt-file whose path can be chosen in "parameters.h".       //
 //     Furthermore it is used in "calculate_corr.cpp" to read in the configuration files     //
 //            created with fprint_field() or alternatively provided configuration.           //
+//          Binary files written by fprint_field_binary() (see "field_io.cpp") are           //
+//                                   read as well.                                           //
 //                                                                                           //
 //###########################################################################################//
 
 int fread_field(const char *filename, scalar_field *p_phi) {
 
+  // Binary configurations (see "field_io.cpp") are recognised by their header:
+  if(is_binary_field(filename)) {
+    return fread_field_binary(filename, p_phi);
+  }
+
   FILE* file = fopen(filename, "r");   // Opens the file "filename" which should be read in
   char line[100];
   //char line [BUFSIZ];
@@ -0,0 +1,72 @@
+#pragma once
+
+// Thin wrapper around the vector registers used by the kernels in "soa_field.cpp". SIMD_WIDTH
+// doubles are processed at once: 8 with AVX-512, 4 with AVX2 and 1 (plain double) otherwise.
+// All loads and stores are unaligned, so the kernels may start at any lattice point.
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#define SIMD_WIDTH 8
+typedef __m512d vdouble;
+
+static inline vdouble v_load(double const *p) { return _mm512_loadu_pd(p); }
+static inline void v_store(double *p, vdouble a) { _mm512_storeu_pd(p, a); }
+static inline vdouble v_set1(double a) { return _mm512_set1_pd(a); }
+static inline vdouble v_add(vdouble a, vdouble b) { return _mm512_add_pd(a, b); }
+static inline vdouble v_sub(vdouble a, vdouble b) { return _mm512_sub_pd(a, b); }
+static inline vdouble v_mul(vdouble a, vdouble b) { return _mm512_mul_pd(a, b); }
+static inline vdouble v_fmadd(vdouble a, vdouble b, vdouble c) { return _mm512_fmadd_pd(a, b, c); }
+static inline vdouble v_fnmadd(vdouble a, vdouble b, vdouble c) { return _mm512_fnmadd_pd(a, b, c); }
+// Same pairwise sum as _mm512_reduce_add_pd(), whose intrinsics make GCC 12 warn about an
+// uninitialised register (-Wmaybe-uninitialized):
+static inline double v_reduce(vdouble a) {
+  double t[8];
+  _mm512_storeu_pd(t, a);
+  return ((t[0] + t[4]) + (t[2] + t[6])) + ((t[1] + t[5]) + (t[3] + t[7]));
+}
+
+#elif defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define SIMD_WIDTH 4
+typedef __m256d vdouble;
+
+static inline vdouble v_load(double const *p) { return _mm256_loadu_pd(p); }
+static inline void v_store(double *p, vdouble a) { _mm256_storeu_pd(p, a); }
+static inline vdouble v_set1(double a) { return _mm256_set1_pd(a); }
+static inline vdouble v_add(vdouble a, vdouble b) { return _mm256_add_pd(a, b); }
+static inline vdouble v_sub(vdouble a, vdouble b) { return _mm256_sub_pd(a, b); }
+static inline vdouble v_mul(vdouble a, vdouble b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+static inline vdouble v_fmadd(vdouble a, vdouble b, vdouble c) { return _mm256_fmadd_pd(a, b, c); }
+static inline vdouble v_fnmadd(vdouble a, vdouble b, vdouble c) { return _mm256_fnmadd_pd(a, b, c); }
+#else
+static inline vdouble v_fmadd(vdouble a, vdouble b, vdouble c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+static inline vdouble v_fnmadd(vdouble a, vdouble b, vdouble c) { return _mm256_sub_pd(c, _mm256_mul_pd(a, b)); }
+#endif
+static inline double v_reduce(vdouble a) {
+  __m128d low  = _mm256_castpd256_pd128(a);
+  __m128d high = _mm256_extractf128_pd(a, 1);
+  low = _mm_add_pd(low, high);
+  return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+#else
+
+#define SIMD_WIDTH 1
+typedef double vdouble;
+
+static inline vdouble v_load(double const *p) { return *p; }
+static inline void v_store(double *p, vdouble a) { *p = a; }
+static inline vdouble v_set1(double a) { return a; }
+static inline vdouble v_add(vdouble a, vdouble b) { return a + b; }
+static inline vdouble v_sub(vdouble a, vdouble b) { return a - b; }
+static inline vdouble v_mul(vdouble a, vdouble b) { return a * b; }
+static inline vdouble v_fmadd(vdouble a, vdouble b, vdouble c) { return a * b + c; }
+static inline vdouble v_fnmadd(vdouble a, vdouble b, vdouble c) { return c - a * b; }
+static inline double v_reduce(vdouble a) { return a; }
+
+#endif
@@ -0,0 +1,439 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+
+#include "parameters.h"
+#include "geometry.h"
+#include "soa_field.h"
+#include "simd.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// Since t is the fastest index of lattice_point(t,x,y,z) (see "scalar.cpp"), the lattice    //
+// points of the spatial point s = (x*Y + y)*Z + z form a contiguous "row" s*T,...,s*T+T-1.  //
+// The spatial neighbours of a row are again complete rows, which are found in the neighbour //
+// table at t=0 (see "geometry.h"). All kernels below therefore loop over the rows and work  //
+// on SIMD_WIDTH (see "simd.h") consecutive time slices at once. They are templates of the   //
+// lattice size G and are called through DISPATCH_GEOMETRY (see "geometry.h"), so that for   //
+// the lattice sizes we run most the row length and the number of rows are constants.        //
+//                                                                                           //
+//*******************************************************************************************//
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//            Vectorised helper functions for n consecutive elements of two rows:            //
+//                                                                                           //
+//###########################################################################################//
+
+// sum_t (re_a[t]*re_b[t] + im_a[t]*im_b[t]) = sum_t Re(a[t]^* b[t])
+static inline double row_dot(double const *re_a, double const *im_a,
+			     double const *re_b, double const *im_b, int n) {
+  vdouble acc = v_set1(0.);
+  double sum = 0.;
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    acc = v_fmadd(v_load(re_a+t), v_load(re_b+t), acc);
+    acc = v_fmadd(v_load(im_a+t), v_load(im_b+t), acc);
+  }
+  for(;t<n;t++) {
+    sum += re_a[t]*re_b[t] + im_a[t]*im_b[t];
+  }
+  return sum + v_reduce(acc);
+}
+
+// sum_t LAMBDA*(|a[t]|^2 - 1)^2 + |a[t]|^2
+static inline double row_potential(double const *re_a, double const *im_a, int n) {
+  vdouble acc = v_set1(0.);
+  vdouble one = v_set1(1.), lambda = v_set1(LAMBDA);
+  vdouble phi2, aux;
+  double sum = 0., phi2_s;
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    phi2 = v_mul(v_load(re_a+t), v_load(re_a+t));
+    phi2 = v_fmadd(v_load(im_a+t), v_load(im_a+t), phi2);
+    aux  = v_sub(phi2, one);
+    acc  = v_add(acc, v_fmadd(v_mul(lambda, aux), aux, phi2));
+  }
+  for(;t<n;t++) {
+    phi2_s = re_a[t]*re_a[t] + im_a[t]*im_a[t];
+    sum += LAMBDA*(phi2_s - 1)*(phi2_s - 1) + phi2_s;
+  }
+  return sum + v_reduce(acc);
+}
+
+// dst[t] += src[t]
+static inline void row_add(double *dst, double const *src, int n) {
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    v_store(dst+t, v_add(v_load(dst+t), v_load(src+t)));
+  }
+  for(;t<n;t++) {
+    dst[t] += src[t];
+  }
+}
+
+// dst[t] += a*src[t]
+static inline void row_axpy(double *dst, double a, double const *src, int n) {
+  vdouble va = v_set1(a);
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    v_store(dst+t, v_fmadd(va, v_load(src+t), v_load(dst+t)));
+  }
+  for(;t<n;t++) {
+    dst[t] += a*src[t];
+  }
+}
+
+// (m_re[t] + i m_im[t]) += c*(4*LAMBDA*(|a[t]|^2 - 1) + 2)*(re_a[t] + i im_a[t])
+static inline void row_potential_force(double *m_re, double *m_im, double c,
+				       double const *re_a, double const *im_a, int n) {
+  vdouble vc = v_set1(c), lambda4 = v_set1(4*LAMBDA), offset = v_set1(2 - 4*LAMBDA);
+  vdouble phi2, f;
+  double phi2_s, f_s;
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    phi2 = v_mul(v_load(re_a+t), v_load(re_a+t));
+    phi2 = v_fmadd(v_load(im_a+t), v_load(im_a+t), phi2);
+    f    = v_mul(vc, v_fmadd(lambda4, phi2, offset));
+    v_store(m_re+t, v_fmadd(f, v_load(re_a+t), v_load(m_re+t)));
+    v_store(m_im+t, v_fmadd(f, v_load(im_a+t), v_load(m_im+t)));
+  }
+  for(;t<n;t++) {
+    phi2_s = re_a[t]*re_a[t] + im_a[t]*im_a[t];
+    f_s = c*(4*LAMBDA*phi2_s + 2 - 4*LAMBDA);
+    m_re[t] += f_s*re_a[t];
+    m_im[t] += f_s*im_a[t];
+  }
+}
+
+// (sum_re[t] + i sum_im[t]) += (c + i d)*(re_a[t] + i im_a[t])
+static inline void row_phase_add(double *sum_re, double *sum_im, double c, double d,
+				 double const *re_a, double const *im_a, int n) {
+  vdouble vc = v_set1(c), vd = v_set1(d);
+  int t = 0;
+
+  for(;t+SIMD_WIDTH<=n;t+=SIMD_WIDTH) {
+    v_store(sum_re+t, v_fnmadd(vd, v_load(im_a+t), v_fmadd(vc, v_load(re_a+t), v_load(sum_re+t))));
+    v_store(sum_im+t, v_fmadd(vd, v_load(re_a+t), v_fmadd(vc, v_load(im_a+t), v_load(sum_im+t))));
+  }
+  for(;t<n;t++) {
+    sum_re[t] += c*re_a[t] - d*im_a[t];
+    sum_im[t] += c*im_a[t] + d*re_a[t];
+  }
+}
+
+
+
+//###########################################################################################//
+// (II.)                                                                                     //
+//      Allocation of a soa_field and conversion from and to the legacy "scalar_field":      //
+//                                                                                           //
+//###########################################################################################//
+
+int soa_alloc(soa_field *p_aux) {
+
+  void *re = NULL, *im = NULL;
+
+  if(posix_memalign(&re, soa_alignment, (volume) * sizeof(double)) != 0 ||
+     posix_memalign(&im, soa_alignment, (volume) * sizeof(double)) != 0) {
+    printf("Failed to allocate a soa_field\n");
+    exit(1);
+  }
+  p_aux->re = (double *) re;
+  p_aux->im = (double *) im;
+  return 0;
+}
+
+void soa_free(soa_field *p_aux) {
+
+  free(p_aux->re);
+  free(p_aux->im);
+  p_aux->re = NULL;
+  p_aux->im = NULL;
+}
+
+int soa_from_field(soa_field *p_aux, scalar_field phi) {
+
+  double *re = p_aux->re, *im = p_aux->im;
+  int ipt;
+
+#pragma omp parallel for schedule(static)
+  for(ipt=0;ipt<volume;ipt++) {
+    re[ipt] = phi[ipt].re;
+    im[ipt] = phi[ipt].im;
+  }
+  return 0;
+}
+
+int soa_to_field(scalar_field phi, soa_field const *p_aux) {
+
+  double const *re = p_aux->re, *im = p_aux->im;
+  int ipt;
+
+#pragma omp parallel for schedule(static)
+  for(ipt=0;ipt<volume;ipt++) {
+    phi[ipt].re = re[ipt];
+    phi[ipt].im = im[ipt];
+  }
+  return 0;
+}
+
+
+
+//###########################################################################################//
+// (III.)                                                                                    //
+//     Action S = sum_x [ LAMBDA*(|phi_x|^2 - 1)^2 + |phi_x|^2 - 2*KAPPA*sum_mu Re(phi_x^*   //
+//   phi_x+mu) ] with the forward neighbours x+mu (same result as eval_action_nogauge()):    //
+//                                                                                           //
+//###########################################################################################//
+
+template<class G>
+static double eval_action_kernel(soa_field const *p_phi) {
+
+  double const *re = p_phi->re, *im = p_phi->im;
+  double potential[soa_reduction_blocks], hopping[soa_reduction_blocks];
+  double sum_potential = 0., sum_hopping = 0.;
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  int b, s, mu, row, row_mu;
+
+#pragma omp parallel for schedule(static) private(s, mu, row, row_mu)
+  for(b=0;b<soa_reduction_blocks;b++) {
+
+    potential[b] = 0.;
+    hopping[b]   = 0.;
+
+    for(s=(long) LS*b/soa_reduction_blocks;s<(long) LS*(b+1)/soa_reduction_blocks;s++) {
+
+      row = s*LT;
+
+      potential[b] += row_potential(re+row, im+row, LT);
+
+      // Forward neighbour in t: t+1 inside the row, periodic from T-1 to 0:
+      hopping[b] += row_dot(re+row, im+row, re+row+1, im+row+1, LT-1);
+      hopping[b] += re[row+LT-1]*re[row] + im[row+LT-1]*im[row];
+
+      // Forward neighbours in x,y,z are complete rows:
+      for(mu=1;mu<4;mu++) {
+	row_mu = neighbour(row,mu);
+	hopping[b] += row_dot(re+row, im+row, re+row_mu, im+row_mu, LT);
+      }
+    }
+  }
+
+  for(b=0;b<soa_reduction_blocks;b++) {
+    sum_potential += potential[b];
+    sum_hopping   += hopping[b];
+  }
+  return sum_potential - KAPPA*2*sum_hopping;
+}
+
+double soa_eval_action(soa_field const *p_phi) {
+  DISPATCH_GEOMETRY(eval_action_kernel, p_phi);
+}
+
+
+
+//###########################################################################################//
+// (IV.)                                                                                     //
+//     Nearest-neighbour hopping sum hop_x = sum_{mu=0}^{7} phi_{x+mu} over all forward      //
+//              and backward neighbours of every lattice point x:                            //
+//                                                                                           //
+//###########################################################################################//
+
+template<class G>
+static void hopping_sum_kernel(soa_field const *p_phi, soa_field *p_hop) {
+
+  double const *re = p_phi->re, *im = p_phi->im;
+  double *hre = p_hop->re, *him = p_hop->im;
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  int s, mu, row, row_mu;
+
+#pragma omp parallel for schedule(static) private(mu, row, row_mu)
+  for(s=0;s<LS;s++) {
+
+    row = s*LT;
+
+    // Neighbours in t: t+1 and t-1 inside the row, periodic at 0 and T-1:
+    memcpy(hre+row, re+row+1, (LT-1)*sizeof(double));
+    memcpy(him+row, im+row+1, (LT-1)*sizeof(double));
+    hre[row+LT-1] = re[row];
+    him[row+LT-1] = im[row];
+
+    row_add(hre+row+1, re+row, LT-1);
+    row_add(him+row+1, im+row, LT-1);
+    hre[row] += re[row+LT-1];
+    him[row] += im[row+LT-1];
+
+    // Neighbours in x,y,z (forward mu=1,2,3 and backward mu=5,6,7) are complete rows:
+    for(mu=1;mu<n_neighbours;mu++) {
+      if(mu == 4) continue;
+      row_mu = neighbour(row,mu);
+      row_add(hre+row, re+row_mu, LT);
+      row_add(him+row, im+row_mu, LT);
+    }
+  }
+}
+
+void soa_hopping_sum(soa_field const *p_phi, soa_field *p_hop) {
+  DISPATCH_GEOMETRY(hopping_sum_kernel, p_phi, p_hop);
+}
+
+
+
+//###########################################################################################//
+// (V.)                                                                                      //
+//    Time-slice sums sum(t) = sum_{x,y,z} phase(x,y,z) phi(t,x,y,z) for all t at once       //
+//   (phase[(x*Y + y)*Z + z] is e.g. the plane wave exp(i p x) of the momentum p). The rows  //
+//   are summed in soa_reduction_blocks fixed blocks into block_sum, whose partial sums are  //
+//          added in their order, so sum(t) does not depend on the number of threads:        //
+//                                                                                           //
+//###########################################################################################//
+
+template<class G>
+static void timeslice_sum_kernel(soa_field const *p_phi, double const *phase_re,
+				 double const *phase_im, double *sum_re, double *sum_im,
+				 double *block_sum) {
+
+  double const *re = p_phi->re, *im = p_phi->im;
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  int b, s, t;
+
+  // The block b accumulates its rows in block_sum[2*b*LT,...,2*b*LT+2*LT):
+#pragma omp parallel for schedule(static) private(s)
+  for(b=0;b<soa_reduction_blocks;b++) {
+    double *acc_re = block_sum + 2*(long) b*LT, *acc_im = acc_re + LT;
+
+    memset(acc_re, 0, 2*LT*sizeof(double));
+    for(s=(long) LS*b/soa_reduction_blocks;s<(long) LS*(b+1)/soa_reduction_blocks;s++) {
+      row_phase_add(acc_re, acc_im, phase_re[s], phase_im[s], re+s*LT, im+s*LT, LT);
+    }
+  }
+
+  memset(sum_re, 0, LT*sizeof(double));
+  memset(sum_im, 0, LT*sizeof(double));
+  for(b=0;b<soa_reduction_blocks;b++) {
+    for(t=0;t<LT;t++) {
+      sum_re[t] += block_sum[2*(long) b*LT + t];
+      sum_im[t] += block_sum[2*(long) b*LT + LT + t];
+    }
+  }
+}
+
+void soa_timeslice_sum(soa_field const *p_phi, double const *phase_re, double const *phase_im,
+		       double *sum_re, double *sum_im, double *block_sum) {
+  DISPATCH_GEOMETRY(timeslice_sum_kernel, p_phi, phase_re, phase_im, sum_re, sum_im, block_sum);
+}
+
+
+
+//###########################################################################################//
+// (VI.)                                                                                     //
+//   Momentum update of the Hybrid Monte Carlo algorithm (see "hmc.cpp"): mom += eps*F with  //
+//   the force F = -dS/dphi = 2*KAPPA*sum_{mu=0}^{7} phi_{x+mu} - (4*LAMBDA*(|phi_x|^2 - 1)  //
+//   + 2)*phi_x, or only one of its terms (see soa_force_potential, soa_force_hopping). The  //
+//   neighbour rows are added to the momenta directly, so no hopping sum is stored:          //
+//                                                                                           //
+//###########################################################################################//
+
+template<class G>
+static void update_momenta_kernel(soa_field const *p_phi, soa_field *p_mom, double eps,
+				  int terms) {
+
+  double const *re = p_phi->re, *im = p_phi->im;
+  double *mre = p_mom->re, *mim = p_mom->im;
+  double const c = 2*KAPPA*eps;
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  int s, mu, row, row_mu;
+
+#pragma omp parallel for schedule(static) private(mu, row, row_mu)
+  for(s=0;s<LS;s++) {
+
+    row = s*LT;
+
+    if(terms & soa_force_potential) {
+      row_potential_force(mre+row, mim+row, -eps, re+row, im+row, LT);
+    }
+
+    if(terms & soa_force_hopping) {
+
+      // Neighbours in t: t+1 and t-1 inside the row, periodic at 0 and T-1:
+      row_axpy(mre+row, c, re+row+1, LT-1);
+      row_axpy(mim+row, c, im+row+1, LT-1);
+      mre[row+LT-1] += c*re[row];
+      mim[row+LT-1] += c*im[row];
+
+      row_axpy(mre+row+1, c, re+row, LT-1);
+      row_axpy(mim+row+1, c, im+row, LT-1);
+      mre[row] += c*re[row+LT-1];
+      mim[row] += c*im[row+LT-1];
+
+      // Neighbours in x,y,z (forward mu=1,2,3 and backward mu=5,6,7) are complete rows:
+      for(mu=1;mu<n_neighbours;mu++) {
+	if(mu == 4) continue;
+	row_mu = neighbour(row,mu);
+	row_axpy(mre+row, c, re+row_mu, LT);
+	row_axpy(mim+row, c, im+row_mu, LT);
+      }
+    }
+  }
+}
+
+void soa_update_momenta(soa_field const *p_phi, soa_field *p_mom, double eps, int terms) {
+  DISPATCH_GEOMETRY(update_momenta_kernel, p_phi, p_mom, eps, terms);
+}
+
+// y += a*x for all lattice points:
+template<class G>
+static void axpy_kernel(double a, soa_field const *p_x, soa_field *p_y) {
+
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  int s;
+
+#pragma omp parallel for schedule(static)
+  for(s=0;s<LS;s++) {
+    row_axpy(p_y->re+s*LT, a, p_x->re+s*LT, LT);
+    row_axpy(p_y->im+s*LT, a, p_x->im+s*LT, LT);
+  }
+}
+
+void soa_axpy(double a, soa_field const *p_x, soa_field *p_y) {
+  DISPATCH_GEOMETRY(axpy_kernel, a, p_x, p_y);
+}
+
+// sum_x |x|^2:
+template<class G>
+static double norm2_kernel(soa_field const *p_x) {
+
+  int const LT = G::t(), LS = G::x()*G::y()*G::z();
+  double norm[soa_reduction_blocks], sum = 0.;
+  int b, s;
+
+#pragma omp parallel for schedule(static) private(s)
+  for(b=0;b<soa_reduction_blocks;b++) {
+    norm[b] = 0.;
+    for(s=(long) LS*b/soa_reduction_blocks;s<(long) LS*(b+1)/soa_reduction_blocks;s++) {
+      norm[b] += row_dot(p_x->re+s*LT, p_x->im+s*LT, p_x->re+s*LT, p_x->im+s*LT, LT);
+    }
+  }
+
+  for(b=0;b<soa_reduction_blocks;b++) {
+    sum += norm[b];
+  }
+  return sum;
+}
+
+double soa_norm2(soa_field const *p_x) {
+  DISPATCH_GEOMETRY(norm2_kernel, p_x);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "types.h"
+
+// Alignment (in bytes) of the arrays of a soa_field, i.e. the size of an AVX-512 register:
+#define soa_alignment 64
+
+// Structure-of-arrays storage of a complex scalar field: the real and imaginary parts of all
+// lattice points ipt = lattice_point(t,x,y,z) are stored in two separate aligned arrays. The
+// legacy layout "scalar_field" (see "types.h") is converted with soa_from_field() and
+// soa_to_field().
+struct soa_field {
+  double *re;
+  double *im;
+};
+
+int soa_alloc(soa_field *p_aux);
+void soa_free(soa_field *p_aux);
+int soa_from_field(soa_field *p_aux, scalar_field phi);
+int soa_to_field(scalar_field phi, soa_field const *p_aux);
+
+// The sums over the lattice (soa_eval_action(), soa_norm2(), soa_timeslice_sum()) add the
+// rows in soa_reduction_blocks fixed blocks, whose partial sums are added in their order, so
+// the result does not depend on the number of threads (see hmc() in "hmc.cpp"):
+#define soa_reduction_blocks 256
+
+double soa_eval_action(soa_field const *p_phi);
+void soa_hopping_sum(soa_field const *p_phi, soa_field *p_hop);
+// block_sum is the scratch space of the blocks, 2*soa_reduction_blocks*T doubles:
+void soa_timeslice_sum(soa_field const *p_phi, double const *phase_re, double const *phase_im,
+		       double *sum_re, double *sum_im, double *block_sum);
+
+// Terms of the force -dS/dphi used by soa_update_momenta(): the local potential
+// -(4*LAMBDA*(|phi_x|^2 - 1) + 2)*phi_x and the hopping term 2*KAPPA*sum_mu phi_x+mu:
+enum {
+  soa_force_potential = 1,
+  soa_force_hopping   = 2,
+  soa_force_all       = 3
+};
+
+void soa_update_momenta(soa_field const *p_phi, soa_field *p_mom, double eps, int terms);
+void soa_axpy(double a, soa_field const *p_x, soa_field *p_y);
+double soa_norm2(soa_field const *p_x);
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "parameters.h"
+#include "thermalise.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// A hot or cold start relaxes towards equilibrium, so its action drifts. The last           //
+// 2*therm_window measurements of the action are split into two halves. The drift is the     //
+// difference of their means, its error is estimated from the variances within the halves.   //
+// The chain counts as thermalised once |drift| <= therm_z*error. The error assumes          //
+// independent measurements, so n_therm_check should be at least a few autocorrelation times //
+// of the action (see "autocorr.cpp"): then the test does not fail by correlated noise. As   //
+// long as the action still decreases steadily, the drift is much larger than the noise.     //
+//                                                                                           //
+//*******************************************************************************************//
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   1 if the last 2*window measurements of the action show no drift, else 0. The drift and  //
+//                         its error are returned, too:                                      //
+//                                                                                           //
+//###########################################################################################//
+
+int drift_test(double const *action, int n, int window, double *p_drift, double *p_error) {
+
+  double mean[2] = {0., 0.}, var[2] = {0., 0.}, d;
+  int h, k;
+
+  *p_drift = 0.;
+  *p_error = 0.;
+  if(n < 2*window) {
+    return 0;
+  }
+
+  for(h=0;h<2;h++) {
+    double const *a = action + n - 2*window + h*window;
+
+    for(k=0;k<window;k++) {
+      mean[h] += a[k];
+    }
+    mean[h] /= window;
+    for(k=0;k<window;k++) {
+      d = a[k] - mean[h];
+      var[h] += d*d;
+    }
+    var[h] /= (window - 1);
+  }
+
+  *p_drift = mean[1] - mean[0];
+  *p_error = sqrt((var[0] + var[1])/window);
+  return (fabs(*p_drift) <= therm_z * *p_error);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Stationarity test of the action during the thermalisation (n_therm_check > 0, see
+// "thermalise.cpp"). action[0],...,action[n-1] are measured every n_therm_check steps:
+int drift_test(double const *action, int n, int window, double *p_drift, double *p_error);
@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "parameters.h"
+#include "tune.h"
+
+
+
+//*******************************************************************************************//
+//                                                                                           //
+// NOTE:                                                                                     //
+//                                                                                           //
+// The Metropolis hits (update_mode 0 and 1, replicas and chains) propose phi + deltarho*u,  //
+// u uniform in [-1,1)^2, their acceptance falls with deltarho. deltarho is multiplied by    //
+// acceptance/tune_acceptance. The HMC (update_mode 2) integrates hmc_tau in hmc_n_steps     //
+// steps of the second order Omelyan integrator, so <Delta H> grows like the fourth power of //
+// the step size hmc_tau/hmc_n_steps and 1 - acceptance, which is proportional to            //
+// sqrt(<Delta H>) for small <Delta H>, like its square. hmc_n_steps is therefore multiplied //
+// by ((1 - acceptance)/(1 - tune_acceptance_hmc))^(1/2). Both factors are limited to        //
+// [1/2, 2] to damp the fluctuations of the acceptance of one interval. The same values are  //
+// used by all threads, so the checkerboard sweeps still do not depend on the number of      //
+// threads. The tuned values are printed, stored in every checkpoint and in the header of    //
+// every binary configuration (see "field_io.h").                                            //
+//                                                                                           //
+//*******************************************************************************************//
+
+#define tune_factor_max 2.
+
+
+
+//###########################################################################################//
+// (I.)                                                                                      //
+//   Adapt deltarho or hmc_n_steps to the acceptance of the last interval of the             //
+//                                   thermalisation:                                         //
+//                                                                                           //
+//###########################################################################################//
+
+static double limit_factor(double factor) {
+
+  if(factor > tune_factor_max)   return tune_factor_max;
+  if(factor < 1/tune_factor_max) return 1/tune_factor_max;
+  return factor;
+}
+
+void tune_proposal(double acceptance) {
+
+  double factor;
+  long n_steps;
+
+  if(update_mode == 2 && n_replica < 2 && n_chain < 2) {
+
+    factor = limit_factor(pow((1 - acceptance)/(1 - tune_acceptance_hmc), 0.5));
+    n_steps = lround(hmc_n_steps*factor);
+    hmc_n_steps = (n_steps < 1 ? 1 : (int) n_steps);
+    printf("tuning: acceptance = %f, hmc_n_steps = %d \n", acceptance, hmc_n_steps);
+  }
+  else {
+
+    factor = limit_factor(acceptance/tune_acceptance);
+    deltarho *= factor;
+    printf("tuning: acceptance = %f, deltarho = %f \n", acceptance, deltarho);
+  }
+}
+
+void print_tuned_proposal(void) {
+
+  if(update_mode == 2 && n_replica < 2 && n_chain < 2) {
+    printf("Tuned proposal (fixed from now on): hmc_n_steps = %d (step size %f) \n",
+	   hmc_n_steps, hmc_tau/hmc_n_steps);
+  }
+  else {
+    printf("Tuned proposal (fixed from now on): deltarho = %.17g \n", deltarho);
+  }
+}
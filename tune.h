@@ -0,0 +1,7 @@
+#pragma once
+
+// Adaptive proposal width during the thermalisation (n_tune > 0, see "tune.cpp"): after every
+// n_tune steps the width of the update in use is adapted to the acceptance of these steps.
+// The tuned values stay fixed for the saved configurations:
+void tune_proposal(double acceptance);
+void print_tuned_proposal(void);